@@ -0,0 +1,196 @@
+#include "Capture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Room left after each upscaled row for the kernels' last, partial,
+// vector store.
+const unsigned UPSCALE_PADDING = 16;
+
+// Size of the stdio buffer of the output file.
+const size_t CAPTURE_BUFFER_SIZE = 1u << 20;
+
+void upscale_row(const uint32_t* source, unsigned width, unsigned scale, uint32_t* destination)
+{
+    for (unsigned x = 0; x < width; ++x)
+    {
+        uint32_t* out = destination + x * scale;
+
+#ifdef __SSE2__
+        // Broadcast the pixel to a whole vector, and store as many of
+        // them as it takes to cover 'scale' pixels. The last store may
+        // spill into the place of the next pixel, which overwrites it
+        // right after (or into the padding, for the last pixel).
+        __m128i pixel = _mm_set1_epi32(static_cast<int>(source[x]));
+
+        for (unsigned i = 0; i < scale; i += 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), pixel);
+        }
+#else
+        for (unsigned i = 0; i < scale; ++i)
+        {
+            out[i] = source[x];
+        }
+#endif
+    }
+}
+
+void upscale_row(const uint8_t* source, unsigned width, unsigned scale, uint8_t* destination)
+{
+    for (unsigned x = 0; x < width; ++x)
+    {
+        uint8_t* out = destination + x * scale;
+
+#ifdef __SSE2__
+        __m128i pixel = _mm_set1_epi8(static_cast<char>(source[x]));
+
+        for (unsigned i = 0; i < scale; i += 16)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), pixel);
+        }
+#else
+        std::memset(out, source[x], scale);
+#endif
+    }
+}
+
+Capture::Capture(const char* filename, unsigned scale): scale(std::max((scale + 1) / 2, 1u))
+{
+    std::string_view name {filename};
+    y4m = name.size() >= 4 && name.substr(name.size() - 4) == ".y4m";
+
+    file = std::fopen(filename, "wb");
+
+    if(!file)
+        return;
+
+    std::setvbuf(file, nullptr, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    unsigned width = VIDEO_WIDTH * this->scale;
+    unsigned height = VIDEO_HEIGHT * this->scale;
+
+    // Y4M: a stream header, then each frame is "FRAME" followed by the
+    // luma plane ('Cmono': there is no chroma).
+    if(y4m)
+        std::fprintf(file, "YUV4MPEG2 W%u H%u F60:1 Ip A1:1 Cmono XCOLORRANGE=FULL\n", width, height);
+
+    row.resize(width + UPSCALE_PADDING);
+    lumaRow.resize(width + UPSCALE_PADDING);
+    output.resize(width * height * (y4m ? 1 : 4));
+
+    queue = std::make_unique<RingBuffer<Frame, 64>>();
+    writer = std::thread([this] { write_frames(); });
+}
+
+Capture::~Capture()
+{
+    if(!file)
+        return;
+
+    done.store(true, std::memory_order_release);
+    writer.join();
+
+    std::fclose(file);
+}
+
+void Capture::push(const uint32_t* video, unsigned width, unsigned height)
+{
+    if(!file)
+        return;
+
+    Frame frame;
+    std::memcpy(frame.pixels.data(), video, width * height * sizeof(uint32_t));
+    frame.width = width;
+    frame.height = height;
+
+    while (!queue->push(frame))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Capture::write_frames()
+{
+    Frame frame;
+
+    for (;;)
+    {
+        // Frames pushed before 'done' was set are all in the queue by
+        // the time we see it, so we drain it one last time and stop.
+        bool finishing = done.load(std::memory_order_acquire);
+
+        while (queue->pop(frame))
+        {
+            write_frame(frame);
+        }
+
+        if(finishing)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Capture::write_frame(const Frame& frame)
+{
+    unsigned width = VIDEO_WIDTH * scale;
+    uint8_t* out = output.data();
+
+    // Low resolution pixels are twice as big.
+    unsigned factor = scale * (VIDEO_WIDTH / frame.width);
+
+    for (unsigned y = 0; y < frame.height; ++y)
+    {
+        const uint32_t* pixels = frame.pixels.data() + y * frame.width;
+
+        // The pixels are RGBA8888, that is 0xRRGGBBAA: convert them to
+        // the output format first, then upscale the row...
+        if(y4m)
+        {
+            uint8_t luma[VIDEO_WIDTH];
+
+            for (unsigned x = 0; x < frame.width; ++x)
+            {
+                uint32_t r = pixels[x] >> 24u, g = (pixels[x] >> 16u) & 0xFFu, b = (pixels[x] >> 8u) & 0xFFu;
+                luma[x] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b) >> 8u);
+            }
+
+            upscale_row(luma, frame.width, factor, lumaRow.data());
+        }
+        else
+        {
+            uint32_t rgba[VIDEO_WIDTH];
+
+            for (unsigned x = 0; x < frame.width; ++x)
+            {
+                uint8_t bytes[4] = {static_cast<uint8_t>(pixels[x] >> 24u), static_cast<uint8_t>(pixels[x] >> 16u),
+                                    static_cast<uint8_t>(pixels[x] >> 8u), static_cast<uint8_t>(pixels[x])};
+                std::memcpy(&rgba[x], bytes, sizeof(bytes));
+            }
+
+            upscale_row(rgba, frame.width, factor, row.data());
+        }
+
+        // ...and repeat it 'factor' times.
+        size_t rowBytes = y4m ? width : width * 4;
+        const void* upscaled = y4m ? static_cast<const void*>(lumaRow.data()) : static_cast<const void*>(row.data());
+
+        for (unsigned i = 0; i < factor; ++i)
+        {
+            std::memcpy(out, upscaled, rowBytes);
+            out += rowBytes;
+        }
+    }
+
+    if(y4m)
+        std::fputs("FRAME\n", file);
+
+    std::fwrite(output.data(), 1, output.size(), file);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Chip8.hpp"
+#include "RingBuffer.hpp"
+
+// Records the frames of the machine to a video file, without needing a
+// window: either a Y4M stream (monochrome, readable by ffmpeg and most
+// players) when the file name ends in ".y4m", or else raw RGBA frames,
+// one after the other. Frames are upscaled by an integer factor with
+// nearest-neighbor, like the window does: the video is the size of the
+// high resolution screen (128x64) upscaled by half the scale, rounded
+// up, so that frames of either resolution fill it.
+//
+// push() only copies the frame into a queue; upscaling and writing are
+// done by a thread of the capture's own, so that recording costs the
+// emulation thread a copy of the frame buffer per frame.
+class Capture
+{
+    public:
+
+        // 'scale' is that of the window, for the low resolution.
+        Capture(const char* filename, unsigned scale);
+
+        // Finishes writing the queued frames and closes the file.
+        ~Capture();
+
+        bool is_open() const { return file != nullptr; }
+
+        // Queue a frame. No frame is ever dropped: if the writer is
+        // more than a queue behind, this waits for it.
+        void push(const uint32_t* video, unsigned width, unsigned height);
+
+    private:
+
+        struct Frame
+        {
+            std::array<uint32_t, VIDEO_WIDTH * VIDEO_HEIGHT> pixels;
+            unsigned width, height;
+        };
+
+        std::FILE* file = nullptr;
+        unsigned scale;
+        bool y4m;
+
+        std::unique_ptr<RingBuffer<Frame, 64>> queue;
+        std::atomic<bool> done {false};
+        std::thread writer;
+
+        // Buffers for the upscaled rows and the whole output frame.
+        std::vector<uint32_t> row;
+        std::vector<uint8_t> lumaRow, output;
+
+        void write_frames();
+        void write_frame(const Frame& frame);
+};
+
+// Nearest-neighbor upscaling of one row of pixels: each of the 'width'
+// pixels of 'source' is repeated 'scale' times in 'destination', which
+// must have room for 16 pixels more than width * scale, the kernels
+// writing whole vectors.
+void upscale_row(const uint32_t* source, unsigned width, unsigned scale, uint32_t* destination);
+void upscale_row(const uint8_t* source, unsigned width, unsigned scale, uint8_t* destination);
@@ -1,8 +1,11 @@
 
 #include "Chip8.hpp"
+#include "Tracer.hpp"
 
 #include <fstream>
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <chrono>
 #include <cstring>
 #include <iostream>
@@ -10,6 +13,8 @@
 const unsigned START_ADDRESS = 0x200;
 const unsigned FONT_START_ADDRESS = 0x50;
 const unsigned FONTSET_SIZE = 80;
+const unsigned BIG_FONT_START_ADDRESS = FONT_START_ADDRESS + FONTSET_SIZE;
+const unsigned BIG_FONTSET_SIZE = 160;
 
 // We need to define the fontset. Each character is represented
 // as a series of 5 bytes, where each bit 1 is a pixel on and
@@ -41,6 +46,32 @@ uint8_t fontset[FONTSET_SIZE] =
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// The SUPER-CHIP adds a bigger font, 8x10, for the high resolution
+// (it only had the digits; the letters are the XO-CHIP's).
+uint8_t bigFontset[BIG_FONTSET_SIZE] =
+{
+        0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+        0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+        0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+        0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+        0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+        0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+        0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+// Colors of the pixels, by the planes they are set in: none, the first,
+// the second, both. With a single plane, pixels are off or on.
+const uint32_t palette[1u << PLANE_COUNT] = {0x00000000, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF};
+
 Chip8::Chip8(): randGen(std::chrono::system_clock::now().time_since_epoch().count())
 {
     // The first instruction executed is at START_ADDRESS
@@ -51,51 +82,101 @@ Chip8::Chip8(): randGen(std::chrono::system_clock::now().time_since_epoch().coun
         memory[FONT_START_ADDRESS + i] = fontset[i];
     }
 
+    for (unsigned i = 0; i < BIG_FONTSET_SIZE; ++i)
+    {
+        memory[BIG_FONT_START_ADDRESS + i] = bigFontset[i];
+    }
+
     // Random number generation between 0 and 255
     randByte = std::uniform_int_distribution<uint8_t>(0, 255u);
 
-    table[0x0] = [this] { table0[opcode & 0x000Fu](); };
+    table[0x0] = [this] { table0[opcode & 0x00FFu](); };
     table[0x1] = [this] { op_1nnn(); };
     table[0x2] = [this] { op_2nnn(); };
     table[0x3] = [this] { op_3xkk(); };
     table[0x4] = [this] { op_4xkk(); };
-    table[0x5] = [this] { op_5xy0(); };
+    table[0x5] = [this] { table5[opcode & 0x000Fu](); };
     table[0x6] = [this] { op_6xkk(); };
     table[0x7] = [this] { op_7xkk(); };
     table[0x8] = [this] { table8[opcode & 0x000Fu](); };
     table[0x9] = [this] { op_9xy0(); };
     table[0xA] = [this] { op_Annn(); };
-    table[0xB] = [this] { op_Bnnn(); };
     table[0xC] = [this] { op_Cxkk(); };
-    table[0xD] = [this] { op_Dxyn(); };
     table[0xE] = [this] { tableE[opcode & 0x000Fu](); };
     table[0xF] = [this] { tableF[opcode & 0x00FFu](); };
 
-    table0[0x0] = [this] { op_00E0(); };
-    table0[0xE] = [this] { op_00EE(); };
+    // 00Cn and 00Dn scroll by n rows: each value of n has its entry.
+    for (uint16_t n = 0; n <= 0xF; ++n)
+    {
+        table0[0xC0 | n] = [this] { op_00Cn(); };
+        table0[0xD0 | n] = [this] { op_00Dn(); };
+    }
+
+    table0[0xE0] = [this] { op_00E0(); };
+    table0[0xEE] = [this] { op_00EE(); };
+    table0[0xFB] = [this] { op_00FB(); };
+    table0[0xFC] = [this] { op_00FC(); };
+    table0[0xFD] = [this] { op_00FD(); };
+    table0[0xFE] = [this] { op_00FE(); };
+    table0[0xFF] = [this] { op_00FF(); };
+
+    table5[0x0] = [this] { op_5xy0(); };
+    table5[0x2] = [this] { op_5xy2(); };
+    table5[0x3] = [this] { op_5xy3(); };
 
     table8[0x0] = [this] { op_8xy0(); };
-    table8[0x1] = [this] { op_8xy1(); };
-    table8[0x2] = [this] { op_8xy2(); };
-    table8[0x3] = [this] { op_8xy3(); };
     table8[0x4] = [this] { op_8xy4(); };
     table8[0x5] = [this] { op_8xy5(); };
-    table8[0x6] = [this] { op_8xy6(); };
     table8[0x7] = [this] { op_8xy7(); };
-    table8[0xE] = [this] { op_8xyE(); };
 
     tableE[0x1] = [this] { op_ExA1(); };
     tableE[0xE] = [this] { op_Ex9E(); };
 
+    tableF[0x00] = [this] { op_F000(); };
+    tableF[0x01] = [this] { op_Fn01(); };
+    tableF[0x02] = [this] { op_F002(); };
     tableF[0x07] = [this] { op_Fx07(); };
     tableF[0x0A] = [this] { op_Fx0A(); };
     tableF[0x15] = [this] { op_Fx15(); };
     tableF[0x18] = [this] { op_Fx18(); };
     tableF[0x1E] = [this] { op_Fx1E(); };
     tableF[0x29] = [this] { op_Fx29(); };
+    tableF[0x30] = [this] { op_Fx30(); };
     tableF[0x33] = [this] { op_Fx33(); };
-    tableF[0x55] = [this] { op_Fx55(); };
-    tableF[0x65] = [this] { op_Fx65(); };
+    tableF[0x3A] = [this] { op_Fx3A(); };
+    tableF[0x75] = [this] { op_Fx75(); };
+    tableF[0x85] = [this] { op_Fx85(); };
+
+    set_quirks<ModernQuirks>();
+}
+
+template<typename Quirks>
+void Chip8::set_quirks()
+{
+    // The instructions that depend on quirks are templates over the
+    // profile: here we put the ones for 'Quirks' in the tables.
+    table[0xB] = [this] { op_Bnnn<Quirks>(); };
+    table[0xD] = [this] { op_Dxyn<Quirks>(); };
+
+    table8[0x1] = [this] { op_8xy1<Quirks>(); };
+    table8[0x2] = [this] { op_8xy2<Quirks>(); };
+    table8[0x3] = [this] { op_8xy3<Quirks>(); };
+    table8[0x6] = [this] { op_8xy6<Quirks>(); };
+    table8[0xE] = [this] { op_8xyE<Quirks>(); };
+
+    tableF[0x55] = [this] { op_Fx55<Quirks>(); };
+    tableF[0x65] = [this] { op_Fx65<Quirks>(); };
+}
+
+void Chip8::set_quirks(QuirkProfile profile)
+{
+    switch (profile)
+    {
+        case QuirkProfile::Modern: set_quirks<ModernQuirks>(); break;
+        case QuirkProfile::CosmacVip: set_quirks<CosmacVipQuirks>(); break;
+        case QuirkProfile::SuperChip: set_quirks<SuperChipQuirks>(); break;
+        case QuirkProfile::XoChip: set_quirks<XoChipQuirks>(); break;
+    }
 }
 
 void Chip8::load_ROM(const char* filename)
@@ -107,8 +188,9 @@ void Chip8::load_ROM(const char* filename)
     if(file.is_open())
     {
         // tellg() returns the current read position, which is the end,
-        // thus the size of the file.
-        std::streampos size = file.tellg();
+        // thus the size of the file (anything that doesn't fit in
+        // memory is left out).
+        std::streamoff size = std::min<std::streamoff>(file.tellg(), MEMORY_SIZE - START_ADDRESS);
         char* buffer = new char[size];
 
         // Seek (place the cursor) at offset 0 from std::ios::beg
@@ -129,10 +211,45 @@ void Chip8::load_ROM(const char* filename)
     }
 }
 
+void Chip8::op_00Cn()
+{
+    // Scroll the display down by n rows: move the rows of each
+    // selected plane down, and clear the ones left at the top.
+    unsigned n = opcode & 0x000Fu;
+
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
+    {
+        if(planeMask & (1u << p))
+        {
+            std::memmove(planes[p][n], planes[p][0], (videoHeight - n) * sizeof(planes[p][0]));
+            std::memset(planes[p][0], 0, n * sizeof(planes[p][0]));
+        }
+    }
+}
+
+void Chip8::op_00Dn()
+{
+    // Scroll the display up by n rows (XO-CHIP).
+    unsigned n = opcode & 0x000Fu;
+
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
+    {
+        if(planeMask & (1u << p))
+        {
+            std::memmove(planes[p][0], planes[p][n], (videoHeight - n) * sizeof(planes[p][0]));
+            std::memset(planes[p][videoHeight - n], 0, n * sizeof(planes[p][0]));
+        }
+    }
+}
+
 void Chip8::op_00E0()
 {
-    // Clear the screen: set the entire video buffer to zeros.
-    std::memset(video, 0, sizeof(video));
+    // Clear the screen: set the selected planes to zeros.
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
+    {
+        if(planeMask & (1u << p))
+            std::memset(planes[p], 0, sizeof(planes[p]));
+    }
 }
 
 void Chip8::op_00EE()
@@ -145,13 +262,93 @@ void Chip8::op_00EE()
     pc = stack[sp];
 }
 
+void Chip8::op_00FB()
+{
+    // Scroll the display right by 4 pixels: each word of a row takes
+    // the 4 pixels its left neighbor pushes out.
+    unsigned words = row_words();
+
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
+    {
+        if(!(planeMask & (1u << p)))
+            continue;
+
+        for (unsigned y = 0; y < videoHeight; ++y)
+        {
+            uint64_t* row = planes[p][y];
+
+            for (unsigned k = words; k-- > 0;)
+            {
+                row[k] = (row[k] >> 4u) | (k ? row[k - 1] << 60u : 0);
+            }
+        }
+    }
+}
+
+void Chip8::op_00FC()
+{
+    // Scroll the display left by 4 pixels.
+    unsigned words = row_words();
+
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
+    {
+        if(!(planeMask & (1u << p)))
+            continue;
+
+        for (unsigned y = 0; y < videoHeight; ++y)
+        {
+            uint64_t* row = planes[p][y];
+
+            for (unsigned k = 0; k < words; ++k)
+            {
+                row[k] = (row[k] << 4u) | (k + 1 < words ? row[k + 1] >> 60u : 0);
+            }
+        }
+    }
+}
+
+void Chip8::op_00FD()
+{
+    // Exit the interpreter: there is nowhere to exit to, so the
+    // machine stays on this instruction, which is then a wait loop
+    // that never ends.
+    pc -= 2;
+    idleLoop = 1;
+}
+
+void Chip8::op_00FE()
+{
+    // Switch to the low resolution.
+    set_resolution(LORES_WIDTH, LORES_HEIGHT);
+}
+
+void Chip8::op_00FF()
+{
+    // Switch to the high resolution.
+    set_resolution(VIDEO_WIDTH, VIDEO_HEIGHT);
+}
+
+void Chip8::set_resolution(unsigned width, unsigned height)
+{
+    // Like on the XO-CHIP, changing resolution clears the screen.
+    videoWidth = width;
+    videoHeight = height;
+    std::memset(planes, 0, sizeof(planes));
+}
+
 void Chip8::op_1nnn()
 {
     // Jumpt to location nnn: the opcode is in the form 1nnn, where the
     // last three digits correspond to the adress we want to jump to;
     // we get those digits thanks to the '& 0x0FFF', which is the same
     // as AND'ing with ones only in three last nibbles.
+    uint16_t from = pc - 2;
     pc = opcode & 0x0FFFu;
+
+    // Jumping backwards by at most two instructions is how programs
+    // wait: check if this is one of the wait loops (see 'idleLoop').
+    if(pc + 4 >= from && pc <= from)
+        detect_wait_loop(from);
 }
 
 void Chip8::op_2nnn()
@@ -181,7 +378,7 @@ void Chip8::op_3xkk()
     uint8_t byte = opcode & 0x00FFu;
 
     if(registers[Vx] == byte)
-        pc += 2;
+        skip_next();
 }
 
 void Chip8::op_4xkk()
@@ -191,7 +388,7 @@ void Chip8::op_4xkk()
     uint8_t byte = opcode & 0x00FFu;
 
     if(registers[Vx] != byte)
-        pc += 2;
+        skip_next();
 }
 
 void Chip8::op_5xy0()
@@ -201,7 +398,42 @@ void Chip8::op_5xy0()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     if(registers[Vx] == registers[Vy])
-        pc += 2;
+        skip_next();
+}
+
+void Chip8::op_5xy2()
+{
+    // Store registers Vx through Vy in memory starting at location
+    // 'index', which doesn't move; if x > y, they are stored in
+    // reverse order (XO-CHIP).
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    int step = (Vx <= Vy) ? 1 : -1;
+
+    for (int i = 0, r = Vx; ; ++i, r += step)
+    {
+        memory[static_cast<uint16_t>(index + i)] = registers[r];
+
+        if(r == Vy)
+            break;
+    }
+}
+
+void Chip8::op_5xy3()
+{
+    // Read registers Vx through Vy from memory starting at location
+    // 'index' (XO-CHIP).
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    int step = (Vx <= Vy) ? 1 : -1;
+
+    for (int i = 0, r = Vx; ; ++i, r += step)
+    {
+        registers[r] = memory[static_cast<uint16_t>(index + i)];
+
+        if(r == Vy)
+            break;
+    }
 }
 
 void Chip8::op_6xkk()
@@ -231,6 +463,7 @@ void Chip8::op_8xy0()
     registers[Vx] = registers[Vy];
 }
 
+template<typename Quirks>
 void Chip8::op_8xy1()
 {
     // Set Vx |= Vy
@@ -238,8 +471,12 @@ void Chip8::op_8xy1()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     registers[Vx] |= registers[Vy];
+
+    if constexpr (Quirks::logicResetsVF)
+        registers[15] = 0;
 }
 
+template<typename Quirks>
 void Chip8::op_8xy2()
 {
     // Set Vx &= Vy
@@ -247,8 +484,12 @@ void Chip8::op_8xy2()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     registers[Vx] &= registers[Vy];
+
+    if constexpr (Quirks::logicResetsVF)
+        registers[15] = 0;
 }
 
+template<typename Quirks>
 void Chip8::op_8xy3()
 {
     // Set Vx ^= Vy
@@ -256,6 +497,9 @@ void Chip8::op_8xy3()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     registers[Vx] ^= registers[Vy];
+
+    if constexpr (Quirks::logicResetsVF)
+        registers[15] = 0;
 }
 
 void Chip8::op_8xy4()
@@ -282,6 +526,7 @@ void Chip8::op_8xy5()
     registers[Vx] -= registers[Vy];
 }
 
+template<typename Quirks>
 void Chip8::op_8xy6()
 {
     // Set Vx = Vx SHR 1: the SHR instruction shifts the register
@@ -290,6 +535,11 @@ void Chip8::op_8xy6()
     // we SHR by 1, so Vx is right-shifted by 1 and VF is set to the
     // shifted-out bit.
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+
+    // On the COSMAC VIP, it is Vy that is shifted into Vx.
+    if constexpr (Quirks::shiftUsesVy)
+        registers[Vx] = registers[Vy];
 
     registers[15] = (registers[Vx] & 0x1u); // shifted-out bit into VF
     registers[Vx] >>= 1;
@@ -306,11 +556,16 @@ void Chip8::op_8xy7()
     registers[Vx] = registers[Vy] - registers[Vx];
 }
 
+template<typename Quirks>
 void Chip8::op_8xyE()
 {
     // Set Vx = Vx SHL 1: left shift by 1 Vx, and put the most
     // significant bit into VF.
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+
+    if constexpr (Quirks::shiftUsesVy)
+        registers[Vx] = registers[Vy];
 
     registers[15] = (registers[Vx] & 0x80u) >> 7u; // shifted-out bit into VF
     registers[Vx] <<= 1;
@@ -323,7 +578,7 @@ void Chip8::op_9xy0()
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
 
     if(registers[Vx] != registers[Vy])
-        pc += 2;
+        skip_next();
 }
 
 void Chip8::op_Annn()
@@ -332,10 +587,20 @@ void Chip8::op_Annn()
     index = opcode & 0x0FFFu;
 }
 
+template<typename Quirks>
 void Chip8::op_Bnnn()
 {
-    // Jump to location V0 + nnn
-    pc = registers[0] + opcode & 0x0FFFu;
+    // Jump to location V0 + nnn, or, on the CHIP-48 and SUPER-CHIP,
+    // to xnn + Vx.
+    if constexpr (Quirks::jumpUsesVx)
+    {
+        uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+        pc = (registers[Vx] + opcode) & 0x0FFFu;
+    }
+    else
+    {
+        pc = (registers[0] + opcode) & 0x0FFFu;
+    }
 }
 
 void Chip8::op_Cxkk()
@@ -347,52 +612,97 @@ void Chip8::op_Cxkk()
     registers[Vx] = randByte(randGen) & byte;
 }
 
+template<typename Quirks>
 void Chip8::op_Dxyn()
 {
     // Display from (Vx, Vy) a n-byte sprite starting at memory
-    // location 'index' and set VF = collision: we start iterating
-    // from (Vx, Vy) to (Vx + 8, Vy + n) (a sprite is guaranteed to
-    // be height pixels wide) to check if there is already set pixels
-    // in there, in which case the VF register is set ('collision').
-    // Then sprite pixels and screen pixels are XOR'ed one another.
+    // location 'index' and set VF = collision: each byte is a row of
+    // 8 pixels, where each 1 is a pixel on and each 0 a pixel off (for
+    // example, the two bytes 0xF 0xE7 would make the shape :::..:::).
+    // The sprite pixels are XOR'ed with the screen pixels, and if any
+    // pixel was already set, there is collision and VF is set to 1.
+    // With n = 0, the sprite is 16x16, each row being two bytes.
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
     uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-    uint8_t height = opcode & 0x000Fu;
+    unsigned height = opcode & 0x000Fu;
+    unsigned spriteWidth = 8;
 
-    // The sprite pixels are required to wrap around the screen if
-    // they go beyond the boundary
-    uint8_t xPos = registers[Vx] % VIDEO_WIDTH;
-    uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
+    if(height == 0)
+    {
+        height = 16;
+        spriteWidth = 16;
+    }
+
+    // The starting position wraps around the screen
+    unsigned xPos = registers[Vx] % videoWidth;
+    unsigned yPos = registers[Vy] % videoHeight;
+    unsigned words = row_words();
+    unsigned word = xPos / 64, shift = xPos % 64;
 
     // VF is by default 0
     registers[15] = 0;
 
-    for (int j = 0; j < height; ++j)
+    // On the XO-CHIP, the sprite is drawn on each selected plane, the
+    // data for each plane following the one for the previous.
+    uint16_t address = index;
+
+    for (unsigned p = 0; p < PLANE_COUNT; ++p)
     {
-        // Each byte in memory starting at 'index' is interpreted as
-        // a row of the sprite...
-        uint8_t sprite_byte = memory[index + j];
+        if(!(planeMask & (1u << p)))
+            continue;
 
-        for (int i = 0; i < 8; ++i)
+        for (unsigned j = 0; j < height; ++j)
         {
-            // ...where each 1 is a pixel on and each 0 a pixel off.
-            // (for example, the two bytes 0xF 0xE7 would make the
-            // shape :::..:::)
-            uint8_t sprite_pixel = sprite_byte & (0x80u >> i);
+            uint64_t bits = memory[static_cast<uint16_t>(address + j * spriteWidth / 8)];
+
+            if(spriteWidth == 16)
+                bits = (bits << 8u) | memory[static_cast<uint16_t>(address + j * 2 + 1)];
+
+            // The parts of the sprite going beyond the boundary are
+            // either cut or wrapped around, depending on the quirk.
+            unsigned y = yPos + j;
+
+            if constexpr (Quirks::clipSprites)
+            {
+                if(y >= videoHeight)
+                    break;
+            }
+            else
+            {
+                y %= videoHeight;
+            }
 
-            auto pos = (xPos + i) + (yPos + j)*VIDEO_WIDTH;
-            auto& screen_pixel = video[pos];
+            // Line the row of the sprite up with the words of the screen
+            // row: it lands in the word of its first pixel, and what
+            // goes past that word spills into the next one or, past the
+            // right edge, wraps around to the first one.
+            uint64_t row[ROW_WORDS] {};
+            uint64_t sprite = bits << (64u - spriteWidth);
 
-            if(sprite_pixel)
+            row[word] = sprite >> shift;
+
+            if(shift)
             {
-                // If the screen pixel and the sprite pixel are both
-                // set, there is collision and the VF is set to 1
-                if(screen_pixel == 0xFFFFFFFF)
+                uint64_t spill = sprite << (64u - shift);
+
+                if(word + 1 < words)
+                    row[word + 1] = spill;
+                else if constexpr (!Quirks::clipSprites)
+                    row[0] |= spill;
+            }
+
+            uint64_t* screen = planes[p][y];
+
+            for (unsigned k = 0; k < words; ++k)
+            {
+                if(screen[k] & row[k])
                     registers[15] = 1;
 
-                screen_pixel ^= 0xFFFFFFFF;
+                screen[k] ^= row[k];
             }
         }
+
+        address += height * spriteWidth / 8;
     }
 }
 
@@ -401,10 +711,10 @@ void Chip8::op_Ex9E()
     // Skip the next instruction if a key with the value
     // of Vx is pressed.
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t key = registers[Vx] & 0xFu;
 
-    if(keypad[key])
-        pc += 2;
+    if(keypad & (1u << key))
+        skip_next();
 }
 
 void Chip8::op_ExA1()
@@ -412,10 +722,32 @@ void Chip8::op_ExA1()
     // Skip the next instruction if a key with the value
     // of Vx is not pressed
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t key = registers[Vx] & 0xFu;
 
-    if(!keypad[key])
-        pc += 2;
+    if(!(keypad & (1u << key)))
+        skip_next();
+}
+
+void Chip8::op_F000()
+{
+    // Set index = nnnn, the 16-bit address in the 2 bytes following
+    // the instruction (XO-CHIP): with the other instructions, the
+    // index can only be set to the first 4K of memory.
+    index = (memory[pc] << 8u) | memory[static_cast<uint16_t>(pc + 1)];
+    pc += 2;
+}
+
+void Chip8::op_Fn01()
+{
+    // Select the planes the display instructions apply to: bit i of n
+    // for plane i (XO-CHIP).
+    planeMask = ((opcode & 0x0F00u) >> 8u) & ((1u << PLANE_COUNT) - 1);
+}
+
+void Chip8::op_F002()
+{
+    // Load the 16-byte audio pattern at 'index' (XO-CHIP). Sound
+    // stays the plain tone of the sound timer: the pattern is ignored.
 }
 
 void Chip8::op_Fx07()
@@ -431,19 +763,18 @@ void Chip8::op_Fx0A()
     // Wait for a key press and store the value of the key in Vx.
     uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
-    for (int i = 0; i < 15; ++i)
+    // If several keys are held, the lowest one is taken.
+    if(keypad)
     {
-        if(keypad[i])
-        {
-            registers[Vx] = i;
-            return;
-        }
+        registers[Vx] = std::countr_zero(keypad);
+        return;
     }
 
     // If no key is pressed, the PC (which had been increment by 2
     // precedently) is decremented by 2, which has the effect of
     // running again the same instruction (so the program "waits").
     pc -= 2;
+    idleLoop = 1;
 }
 
 void Chip8::op_Fx15()
@@ -479,6 +810,15 @@ void Chip8::op_Fx29()
     index = FONT_START_ADDRESS + 5 * digit;
 }
 
+void Chip8::op_Fx30()
+{
+    // Set index to the location of the big (8x10) font character Vx.
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t digit = registers[Vx] & 0xFu;
+
+    index = BIG_FONT_START_ADDRESS + 10 * digit;
+}
+
 void Chip8::op_Fx33()
 {
     // Store the BCD representation of Vx starting at the
@@ -495,15 +835,22 @@ void Chip8::op_Fx33()
     // is 8; the reasoning stays the same for any number), and
     // then dividing by 10 gets rid of it (because these are
     // integral values).
-    memory[index + 2] = value % 10;
+    memory[static_cast<uint16_t>(index + 2)] = value % 10;
     value /= 10;
 
-    memory[index + 1] = value % 10;
+    memory[static_cast<uint16_t>(index + 1)] = value % 10;
     value /= 10;
 
     memory[index] = value % 10;
 }
 
+void Chip8::op_Fx3A()
+{
+    // Set the pitch of the audio pattern (XO-CHIP); as the pattern,
+    // it is ignored.
+}
+
+template<typename Quirks>
 void Chip8::op_Fx55()
 {
     // Store registers V0 through Vx in memory starting at
@@ -512,10 +859,15 @@ void Chip8::op_Fx55()
 
     for (int i = 0; i <= Vx; ++i)
     {
-        memory[index + i] = registers[i];
+        memory[static_cast<uint16_t>(index + i)] = registers[i];
     }
+
+    // The COSMAC VIP moves the index as it goes.
+    if constexpr (Quirks::indexIncrements)
+        index += Vx + 1;
 }
 
+template<typename Quirks>
 void Chip8::op_Fx65()
 {
     // Read registers V0 through Vx from memory starting
@@ -524,8 +876,28 @@ void Chip8::op_Fx65()
 
     for (int i = 0; i <= Vx; ++i)
     {
-        registers[i] = memory[index + i];
+        registers[i] = memory[static_cast<uint16_t>(index + i)];
     }
+
+    if constexpr (Quirks::indexIncrements)
+        index += Vx + 1;
+}
+
+void Chip8::op_Fx75()
+{
+    // Store registers V0 through Vx in the RPL flags (SUPER-CHIP; they
+    // were the calculator's user flags).
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+
+    std::memcpy(rplFlags, registers, Vx + 1);
+}
+
+void Chip8::op_Fx85()
+{
+    // Read registers V0 through Vx from the RPL flags.
+    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+
+    std::memcpy(registers, rplFlags, Vx + 1);
 }
 
 void Chip8::cycle()
@@ -534,15 +906,110 @@ void Chip8::cycle()
     // the next instruction in the form of an opcode, decoding it,
     // and executing it through our function pointer table.
 
+    // Key events due by now are applied first, so that the program
+    // sees them at the exact instruction they were scheduled for.
+    if(cycleCount >= nextKeyEvent)
+        apply_key_events();
+
     // Fetch the opcode: it consists of two bytes in memory, at the
     // 'next instruction' adress, stored in the PC...
-    opcode = (memory[pc] << 8u) | memory[pc + 1];
+    opcode = (memory[pc] << 8u) | memory[static_cast<uint16_t>(pc + 1)];
     // ...which is incremented by 2 to point to the next instruction.
     pc += 2;
 
-    // Decode and execute
-    table[(opcode & 0xF000u) >> 12u]();
+    // Decode and execute, letting the tracer (if any) see the state
+    // of the machine before and after the instruction.
+    if(tracer)
+    {
+        tracer->before(*this);
+        table[(opcode & 0xF000u) >> 12u]();
+        tracer->after(*this);
+    }
+    else
+    {
+        table[(opcode & 0xF000u) >> 12u]();
+    }
+
+    ++cycleCount;
+}
+
+void Chip8::run(unsigned cycles)
+{
+    uint64_t end = cycleCount + cycles;
+
+    while (cycleCount < end)
+    {
+        idleLoop = 0;
+        cycle();
+
+        // When tracing, every instruction has to actually run to be
+        // recorded, so there is no skipping.
+        if(idleLoop && !tracer)
+        {
+            // The loop goes on until the end of the run or the next key
+            // event: the PC just went back to the start of the loop, and
+            // ends up 'phase' instructions into it; nothing else changes
+            // (the registers the loop writes already hold the values it
+            // writes).
+            uint64_t until = std::min(end, nextKeyEvent);
+            uint64_t skipped = (until > cycleCount) ? until - cycleCount : 0;
+            unsigned phase = skipped % idleLoop;
+
+            if(phase)
+            {
+                pc += 2 * phase;
+                opcode = (memory[pc - 2] << 8u) | memory[pc - 1];
+            }
+
+            cycleCount += skipped;
+        }
+    }
+}
 
+void Chip8::render()
+{
+    // Each pixel takes the color of the combination of planes it is set
+    // in (see 'palette').
+    for (unsigned y = 0; y < videoHeight; ++y)
+    {
+        uint32_t* out = video + y * videoWidth;
+
+        for (unsigned x = 0; x < videoWidth; ++x)
+        {
+            unsigned bit = 63u - x % 64, word = x / 64;
+            unsigned color = 0;
+
+            for (unsigned p = 0; p < PLANE_COUNT; ++p)
+            {
+                color |= ((planes[p][y][word] >> bit) & 1u) << p;
+            }
+
+            out[x] = palette[color];
+        }
+    }
+}
+
+void Chip8::queue_key_event(uint64_t cycle, uint16_t keys)
+{
+    uint64_t earliest = keyEvents.empty() ? cycleCount : keyEvents.back().cycle + 1;
+
+    keyEvents.push_back({std::max(cycle, earliest), keys});
+    nextKeyEvent = keyEvents.front().cycle;
+}
+
+void Chip8::apply_key_events()
+{
+    while (!keyEvents.empty() && keyEvents.front().cycle <= cycleCount)
+    {
+        keypad = keyEvents.front().keys;
+        keyEvents.pop_front();
+    }
+
+    nextKeyEvent = keyEvents.empty() ? UINT64_MAX : keyEvents.front().cycle;
+}
+
+void Chip8::tick_timers()
+{
     // Delay timer...
     if(delayTimer > 0)
         --delayTimer;
@@ -550,4 +1017,65 @@ void Chip8::cycle()
     // ...and sound timer updates.
     if(soundTimer > 0)
         --soundTimer;
-}
\ No newline at end of file
+}
+
+void Chip8::skip_next()
+{
+    // LD index, nnnn is the one instruction taking 4 bytes.
+    bool longInstruction = memory[pc] == 0xF0u && memory[static_cast<uint16_t>(pc + 1)] == 0x00u;
+
+    pc += longInstruction ? 4 : 2;
+}
+
+void Chip8::detect_wait_loop(uint16_t from)
+{
+    // 'pc' is the start of the loop and 'from' the adress of the jump
+    // closing it: look at what is in between.
+    uint16_t first = (memory[pc] << 8u) | memory[pc + 1];
+    uint16_t second = (memory[pc + 2] << 8u) | memory[pc + 3];
+
+    if(pc == from)
+    {
+        // JP to itself: the program has stopped.
+        idleLoop = 1;
+    }
+    else if(pc + 2 == from)
+    {
+        // SKP Vx / SKNP Vx, then jump back: since we got to the jump,
+        // the key test didn't skip, and it won't until the keypad
+        // changes. It must still not skip with the keypad as it is now,
+        // though (a key may have changed right before the jump).
+        bool skp = (first & 0xF0FFu) == 0xE09Eu;
+        bool sknp = (first & 0xF0FFu) == 0xE0A1u;
+        bool held = keypad & (1u << (registers[(first & 0x0F00u) >> 8u] & 0xFu));
+
+        if((skp && !held) || (sknp && held))
+            idleLoop = 2;
+    }
+    else if(pc + 4 == from)
+    {
+        // LD Vx, DT then SE/SNE Vx, kk, then jump back: the loop goes
+        // on until the timer ticks if the test doesn't skip for the
+        // current value of the delay timer. That can't be told from
+        // having got to the jump, which may have been reached from
+        // outside the loop, so the test is evaluated; Vx must also still
+        // hold the timer value (the timer may have ticked since it was
+        // read).
+        uint8_t Vx = (first & 0x0F00u) >> 8u;
+        uint8_t kk = second & 0x00FFu;
+        bool readsTimer = (first & 0xF0FFu) == 0xF007u;
+        bool testsVx = ((second & 0x0F00u) >> 8u) == Vx;
+        bool se = (second >> 12u) == 0x3;
+        bool sne = (second >> 12u) == 0x4;
+        bool loops = (se && registers[Vx] != kk) || (sne && registers[Vx] == kk);
+
+        if(readsTimer && testsVx && loops && registers[Vx] == delayTimer)
+            idleLoop = 3;
+    }
+}
+
+// The profiles set_quirks() can be used with from other files
+template void Chip8::set_quirks<ModernQuirks>();
+template void Chip8::set_quirks<CosmacVipQuirks>();
+template void Chip8::set_quirks<SuperChipQuirks>();
+template void Chip8::set_quirks<XoChipQuirks>();
@@ -2,17 +2,56 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <random>
 #include <unordered_map>
 #include <functional>
 
-const unsigned VIDEO_WIDTH = 64;
-const unsigned VIDEO_HEIGHT = 32;
+#include "Quirks.hpp"
+
+// The display is 64x32 in low resolution, and 128x64 in the high
+// resolution of the SUPER-CHIP and XO-CHIP; VIDEO_WIDTH and VIDEO_HEIGHT
+// are the largest.
+const unsigned LORES_WIDTH = 64;
+const unsigned LORES_HEIGHT = 32;
+const unsigned VIDEO_WIDTH = 128;
+const unsigned VIDEO_HEIGHT = 64;
+const unsigned PLANE_COUNT = 2;
+const unsigned ROW_WORDS = VIDEO_WIDTH / 64;
 const unsigned KEY_COUNT = 16;
-const unsigned MEMORY_SIZE = 4096;
+const unsigned MEMORY_SIZE = 65536;
 const unsigned REGISTER_COUNT = 16;
 const unsigned STACK_LEVELS = 16;
 
+class Tracer;
+
+// Number of bytes an instruction writes to memory, all starting at the
+// index: only LD B, Vx, LD [index], Vx and SAVE Vx - Vy write there.
+inline unsigned memory_write_length(uint16_t opcode)
+{
+    if((opcode & 0xF0FFu) == 0xF033u)
+        return 3;
+
+    if((opcode & 0xF0FFu) == 0xF055u)
+        return ((opcode & 0x0F00u) >> 8u) + 1;
+
+    if((opcode & 0xF00Fu) == 0x5002u)
+    {
+        int x = (opcode & 0x0F00u) >> 8u, y = (opcode & 0x00F0u) >> 4u;
+        return (x > y ? x - y : y - x) + 1;
+    }
+
+    return 0;
+}
+
+// A change of the keypad state, to be applied when the machine reaches
+// 'cycle': bit i of 'keys' is set while key i is held.
+struct KeyEvent
+{
+    uint64_t cycle;
+    uint16_t keys;
+};
+
 // The CHIP-8 is a virtual machine developped in the 1970s to
 // ease game programming on early computers. What we are writing
 // here is then actually an interpreter; however, understanding
@@ -24,11 +63,12 @@ class Chip8
 
         // The CHIP-8 architecture is comprised of:
         //  - 16 8-bit registers, labeled V0 to VF;
-        //  - 4K bytes of memory, where 0x000-0x1FF is reserved space,
-        //  originally for the interpreter (in our case, we will never
-        //  write there, except for 0x050-0x0A0, where the 16-built
-        //  characters 0 through F are stored). Instructions from the
-        //  ROM are stored starting at 0x200;
+        //  - 4K bytes of memory (64K for the XO-CHIP), where 0x000-0x1FF
+        //  is reserved space, originally for the interpreter (in our
+        //  case, we will never write there, except for 0x050-0x0A0,
+        //  where the 16-built characters 0 through F are stored, and
+        //  0x0A0-0x140, for the big ones of the SUPER-CHIP).
+        //  Instructions from the ROM are stored starting at 0x200;
         //  - a 16-bit index register, where memory adresses for use
         //  in the operations are stored;
         //  - a 16-bit program counter (PC), where is hold the adress
@@ -47,57 +87,154 @@ class Chip8
         //  60 Hz (1 decrement per 1/60 of a second);
         //  - an 8-bit sound timer, used for *sound* timing, with the
         //  same behavior; a single tone will buzz if it's non-zero;
-        //  - 16 input keys, mapped from 1-F to 1234QWERASDFZXCV;
+        //  - 16 input keys, mapped from 1-F to 1234QWERASDFZXCV, which
+        //  we keep as a 16-bit mask (bit i set when key i is held);
         //  - a 64x32 monochrome display memory, with each pixel either
-        //  on or off.
+        //  on or off; the SUPER-CHIP adds a 128x64 high resolution
+        //  mode, and the XO-CHIP a second display plane, giving 4
+        //  colors;
+        //  - for the SUPER-CHIP and XO-CHIP, 16 8-bit "RPL" flag
+        //  registers, where V0 to VF can be saved and restored.
+        //
+        // The extensions also add 16x16 sprites and scrolling.
+        //
+        // Each plane is kept as bits, 64 pixels to a word, leftmost
+        // pixel in the most significant bit, so that clearing and
+        // scrolling are whole-word operations. Only the first
+        // 'videoWidth' pixels of the first 'videoHeight' rows are used
+        // in the current resolution. render() turns the planes into
+        // RGBA pixels in 'video', row after row at the current width.
+        uint64_t planes[PLANE_COUNT][VIDEO_HEIGHT][ROW_WORDS] {};
         uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT] {};
-        uint16_t index, pc, opcode, stack[STACK_LEVELS] {};
-        uint8_t sp, delayTimer, soundTimer;
-        uint8_t registers[REGISTER_COUNT] {}, memory[MEMORY_SIZE] {}, keypad[KEY_COUNT] {};
+        unsigned videoWidth = LORES_WIDTH, videoHeight = LORES_HEIGHT;
+
+        // Planes that drawing, clearing and scrolling apply to (bit i
+        // for plane i); only the first one unless an XO-CHIP program
+        // selects others.
+        uint8_t planeMask = 1;
+        uint16_t index {}, pc {}, opcode {}, stack[STACK_LEVELS] {};
+        uint8_t sp {}, delayTimer {}, soundTimer {};
+        uint8_t registers[REGISTER_COUNT] {}, memory[MEMORY_SIZE] {};
+        uint8_t rplFlags[REGISTER_COUNT] {};
+        uint16_t keypad {};
+
+        // Number of instructions executed so far, and the tracer
+        // recording them, if any (see Tracer.hpp).
+        uint64_t cycleCount {};
+        Tracer* tracer = nullptr;
+
+        // Length, in instructions, of the wait loop the last instruction
+        // was found to be part of, or 0 if it wasn't part of one. A wait
+        // loop is a loop that changes nothing until either a timer ticks
+        // or a key is pressed or released: spinning on 'LD Vx, DT' to
+        // wait for the delay timer, on 'SKP/SKNP Vx' or 'LD Vx, K' to
+        // wait for a key, or a jump to itself.
+        uint8_t idleLoop {};
 
         std::default_random_engine randGen;
         std::uniform_int_distribution<uint8_t> randByte;
 
         std::array<std::function<void(void)>, 0xF + 1> table {};
-        std::unordered_map<uint16_t, std::function<void(void)>> table0 {}, table8 {}, tableE {}, tableF {};
+        std::unordered_map<uint16_t, std::function<void(void)>> table0 {}, table5 {}, table8 {}, tableE {}, tableF {};
 
         Chip8();
 
+        // Install the versions of the instructions matching a quirk
+        // profile (see Quirks.hpp); the constructor installs the modern
+        // one. The profile can be given as a type or, to choose it at
+        // runtime, as a QuirkProfile.
+        template<typename Quirks>
+        void set_quirks();
+        void set_quirks(QuirkProfile profile);
+
         void load_ROM(const char* filename);
         void cycle();
 
+        // Convert the display planes to RGBA pixels in 'video'.
+        void render();
+
+        // Run 'cycles' instructions. As timers and keys can't change in
+        // the middle of it, as soon as the program enters a wait loop the
+        // remaining instructions are skipped, leaving the machine in the
+        // exact state it would have reached by running them.
+        void run(unsigned cycles);
+
+        // Decrement the delay and sound timers; this is to be called at
+        // 60 Hz, independently of the rate at which instructions run.
+        void tick_timers();
+
+        // Change the keypad state right before instruction number
+        // 'cycle' runs (or before the next one if it is in the past).
+        // Events must be queued in order; each state lasts for at least
+        // one instruction, so that a quick press and release is never
+        // lost.
+        void queue_key_event(uint64_t cycle, uint16_t keys);
+
+        void op_00Cn(); // SCD n
+        void op_00Dn(); // SCU n
         void op_00E0(); // CLS
         void op_00EE(); // RET
+        void op_00FB(); // SCR
+        void op_00FC(); // SCL
+        void op_00FD(); // EXIT
+        void op_00FE(); // LOW
+        void op_00FF(); // HIGH
         void op_1nnn(); // JP nnn
         void op_2nnn(); // CALL nnn
         void op_3xkk(); // SE Vx, kk
         void op_4xkk(); // SNE Vx, kk
         void op_5xy0(); // SE Vx, Vy
+        void op_5xy2(); // SAVE Vx - Vy
+        void op_5xy3(); // LOAD Vx - Vy
         void op_6xkk(); // LD Vx, kk
         void op_7xkk(); // ADD Vx, byte
         void op_8xy0(); // LD Vx, Vy
-        void op_8xy1(); // OR Vx, Vy
-        void op_8xy2(); // AND Vx, Vy
-        void op_8xy3(); // XOR Vx, Vy
+        template<typename Quirks> void op_8xy1(); // OR Vx, Vy
+        template<typename Quirks> void op_8xy2(); // AND Vx, Vy
+        template<typename Quirks> void op_8xy3(); // XOR Vx, Vy
         void op_8xy4(); // ADD Vx, Vy
         void op_8xy5(); // SUB Vx, Vy
-        void op_8xy6(); // SHR Vx, 1
+        template<typename Quirks> void op_8xy6(); // SHR Vx, 1
         void op_8xy7(); // SUBN Vx, Vy
-        void op_8xyE(); // SHL Vx, 1
+        template<typename Quirks> void op_8xyE(); // SHL Vx, 1
         void op_9xy0(); // SNE Vx, Vy
         void op_Annn(); // LD index, nnn
-        void op_Bnnn(); // JP V0, nnn
+        template<typename Quirks> void op_Bnnn(); // JP V0, nnn
         void op_Cxkk(); // RND Vx, kk
-        void op_Dxyn(); // DRW Vx, Vy, n
+        template<typename Quirks> void op_Dxyn(); // DRW Vx, Vy, n
         void op_Ex9E(); // SKP Vx
         void op_ExA1(); // SKNP Vx
+        void op_F000(); // LD index, nnnn
+        void op_Fn01(); // PLANE n
+        void op_F002(); // AUDIO
         void op_Fx07(); // LD Vx, DT
         void op_Fx0A(); // LD Vx, K
         void op_Fx15(); // LD DT, Vx
         void op_Fx18(); // LD ST, Vx
         void op_Fx1E(); // ADD index, Vx
         void op_Fx29(); // LD F, Vx
+        void op_Fx30(); // LD HF, Vx
         void op_Fx33(); // LD B, Vx
-        void op_Fx55(); // LD [index], Vx
-        void op_Fx65(); // LD Vx, [index]
+        void op_Fx3A(); // PITCH Vx
+        template<typename Quirks> void op_Fx55(); // LD [index], Vx
+        template<typename Quirks> void op_Fx65(); // LD Vx, [index]
+        void op_Fx75(); // LD R, Vx
+        void op_Fx85(); // LD Vx, R
+
+    private:
+
+        std::deque<KeyEvent> keyEvents;
+        uint64_t nextKeyEvent = UINT64_MAX;
+
+        void apply_key_events();
+        void detect_wait_loop(uint16_t from);
+
+        // Skip the next instruction, which may be the 4-byte
+        // LD index, nnnn of the XO-CHIP.
+        void skip_next();
+
+        // Number of words of the planes' rows in the current resolution.
+        unsigned row_words() const { return videoWidth / 64; }
+
+        void set_resolution(unsigned width, unsigned height);
 };
\ No newline at end of file
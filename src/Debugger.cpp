@@ -0,0 +1,148 @@
+#include "Debugger.hpp"
+
+#include <cstring>
+
+void Debugger::set_breakpoint(uint16_t address)
+{
+    address %= MEMORY_SIZE;
+
+    if(!breakpoints[address])
+    {
+        breakpoints.set(address);
+        ++breakpointCount;
+    }
+}
+
+void Debugger::clear_breakpoint(uint16_t address)
+{
+    address %= MEMORY_SIZE;
+
+    if(breakpoints[address])
+    {
+        breakpoints.reset(address);
+        --breakpointCount;
+    }
+}
+
+void Debugger::set_watchpoint(uint16_t address, uint16_t length)
+{
+    for (unsigned i = 0; i < length; ++i)
+    {
+        unsigned byte = (address + i) % MEMORY_SIZE;
+
+        if(!watched[byte])
+        {
+            watched.set(byte);
+            ++watchCount;
+        }
+    }
+}
+
+void Debugger::clear_watchpoint(uint16_t address, uint16_t length)
+{
+    for (unsigned i = 0; i < length; ++i)
+    {
+        unsigned byte = (address + i) % MEMORY_SIZE;
+
+        if(watched[byte])
+        {
+            watched.reset(byte);
+            --watchCount;
+        }
+    }
+}
+
+void Debugger::watch_register(unsigned reg, bool watch)
+{
+    if(watch)
+        registerWatch |= 1u << reg;
+    else
+        registerWatch &= ~(1u << reg);
+}
+
+void Debugger::clear_all()
+{
+    breakpoints.reset();
+    watched.reset();
+    breakpointCount = watchCount = 0;
+    registerWatch = 0;
+}
+
+StopReason Debugger::run(uint64_t cycles)
+{
+    for (uint64_t i = 0; i < cycles; ++i)
+    {
+        // Breakpoints stop the machine *before* the instruction, unless
+        // we are resuming from that very breakpoint.
+        bool resuming = chip8.pc == stopPc && chip8.cycleCount == stopCycle;
+
+        if(breakpoints[chip8.pc % MEMORY_SIZE] && !resuming)
+        {
+            stopPc = chip8.pc;
+            stopCycle = chip8.cycleCount;
+            return StopReason::Breakpoint;
+        }
+
+        StopReason reason = execute();
+
+        if(reason != StopReason::None)
+            return reason;
+    }
+
+    return StopReason::None;
+}
+
+StopReason Debugger::step()
+{
+    StopReason reason = execute();
+
+    return (reason == StopReason::None) ? StopReason::Step : reason;
+}
+
+StopReason Debugger::execute()
+{
+    // Find out which bytes the instruction about to run writes to
+    // memory, if any.
+    uint16_t opcode = (chip8.memory[chip8.pc % MEMORY_SIZE] << 8u) | chip8.memory[(chip8.pc + 1) % MEMORY_SIZE];
+    unsigned writeLength = memory_write_length(opcode);
+
+    uint16_t writeAddress = chip8.index;
+
+    // Keep the registers to compare them afterwards (only if some are
+    // watched).
+    uint8_t registers[REGISTER_COUNT];
+    uint16_t index = chip8.index;
+
+    if(registerWatch)
+        std::memcpy(registers, chip8.registers, sizeof(registers));
+
+    chip8.cycle();
+
+    if(watchCount)
+    {
+        for (unsigned i = 0; i < writeLength; ++i)
+        {
+            unsigned byte = (writeAddress + i) % MEMORY_SIZE;
+
+            if(watched[byte])
+            {
+                watchHit = byte;
+                return StopReason::Watchpoint;
+            }
+        }
+    }
+
+    if(registerWatch)
+    {
+        for (unsigned i = 0; i < REGISTER_COUNT; ++i)
+        {
+            if((registerWatch & (1u << i)) && registers[i] != chip8.registers[i])
+                return StopReason::RegisterWatch;
+        }
+
+        if((registerWatch & (1u << WATCH_INDEX)) && index != chip8.index)
+            return StopReason::RegisterWatch;
+    }
+
+    return StopReason::None;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+
+#include "Chip8.hpp"
+
+// Why Debugger::run() or Debugger::step() returned.
+enum class StopReason
+{
+    None,           // all the cycles were run
+    Breakpoint,     // the PC reached a breakpoint (not yet executed)
+    Watchpoint,     // an instruction wrote to a watched memory byte
+    RegisterWatch,  // an instruction changed a watched register
+    Step            // the single instruction asked for was executed
+};
+
+// Bits of the register watch mask: bit i for Vi, then the index.
+const unsigned WATCH_INDEX = REGISTER_COUNT;
+
+// The debugger runs the machine one instruction at a time, checking
+// breakpoints before each one and watchpoints after it. All of this
+// lives outside of Chip8::cycle(): as long as nothing is armed, the
+// frontend keeps using Chip8::run(), which has no check of any kind,
+// and switches to Debugger::run() only while there is something to
+// check.
+class Debugger
+{
+    public:
+
+        explicit Debugger(Chip8& chip8): chip8(chip8) {}
+
+        // Whether there is any breakpoint or watchpoint to check.
+        bool armed() const { return breakpointCount || watchCount || registerWatch; }
+
+        void set_breakpoint(uint16_t address);
+        void clear_breakpoint(uint16_t address);
+
+        // Memory watchpoints stop the machine after an instruction wrote
+        // to one of the 'length' bytes starting at 'address'.
+        void set_watchpoint(uint16_t address, uint16_t length);
+        void clear_watchpoint(uint16_t address, uint16_t length);
+
+        // Register watchpoints stop the machine after an instruction
+        // changed the register: 0 to F for V0 to VF, WATCH_INDEX for the
+        // index.
+        void watch_register(unsigned reg, bool watch);
+
+        void clear_all();
+
+        // Run at most 'cycles' instructions, stopping at the first
+        // breakpoint or watchpoint hit. After a breakpoint, the next run
+        // or step executes the instruction the machine stopped at, so
+        // that it can be resumed.
+        StopReason run(uint64_t cycles);
+
+        // Execute a single instruction (it may still stop on a
+        // watchpoint).
+        StopReason step();
+
+        // The memory adress that triggered the last Watchpoint stop.
+        uint16_t watch_hit() const { return watchHit; }
+
+    private:
+
+        Chip8& chip8;
+
+        std::bitset<MEMORY_SIZE> breakpoints, watched;
+        unsigned breakpointCount = 0, watchCount = 0;
+        uint32_t registerWatch = 0;
+
+        // Where the machine last stopped at a breakpoint: resuming from
+        // there doesn't stop again, as long as the machine hasn't moved
+        // (neither run, nor had its PC changed) in the meantime.
+        uint16_t stopPc = 0;
+        uint64_t stopCycle = UINT64_MAX;
+        uint16_t watchHit = 0;
+
+        StopReason execute();
+};
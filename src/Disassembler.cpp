@@ -0,0 +1,114 @@
+#include "Disassembler.hpp"
+
+#include <cstdio>
+
+std::string disassemble(uint16_t opcode)
+{
+    // The operands are extracted the same way as in the instructions
+    // themselves: x and y are the second and third nibbles, kk the
+    // low byte, nnn the low 12 bits and n the last nibble.
+    unsigned x = (opcode & 0x0F00u) >> 8u;
+    unsigned y = (opcode & 0x00F0u) >> 4u;
+    unsigned kk = opcode & 0x00FFu;
+    unsigned nnn = opcode & 0x0FFFu;
+    unsigned n = opcode & 0x000Fu;
+
+    char text[32];
+
+    auto format = [&](const char* pattern, auto... args)
+    {
+        std::snprintf(text, sizeof(text), pattern, args...);
+        return std::string {text};
+    };
+
+    switch (opcode >> 12u)
+    {
+        case 0x0:
+        {
+            if((opcode & 0xFFF0u) == 0x00C0u) return format("SCD %u", n);
+            if((opcode & 0xFFF0u) == 0x00D0u) return format("SCU %u", n);
+            if(opcode == 0x00E0u) return "CLS";
+            if(opcode == 0x00EEu) return "RET";
+            if(opcode == 0x00FBu) return "SCR";
+            if(opcode == 0x00FCu) return "SCL";
+            if(opcode == 0x00FDu) return "EXIT";
+            if(opcode == 0x00FEu) return "LOW";
+            if(opcode == 0x00FFu) return "HIGH";
+        } break;
+
+        case 0x1: return format("JP 0x%03X", nnn);
+        case 0x2: return format("CALL 0x%03X", nnn);
+        case 0x3: return format("SE V%X, 0x%02X", x, kk);
+        case 0x4: return format("SNE V%X, 0x%02X", x, kk);
+
+        case 0x5:
+        {
+            if(n == 0x0) return format("SE V%X, V%X", x, y);
+            if(n == 0x2) return format("SAVE V%X - V%X", x, y);
+            if(n == 0x3) return format("LOAD V%X - V%X", x, y);
+        } break;
+
+        case 0x6: return format("LD V%X, 0x%02X", x, kk);
+        case 0x7: return format("ADD V%X, 0x%02X", x, kk);
+
+        case 0x8:
+        {
+            switch (n)
+            {
+                case 0x0: return format("LD V%X, V%X", x, y);
+                case 0x1: return format("OR V%X, V%X", x, y);
+                case 0x2: return format("AND V%X, V%X", x, y);
+                case 0x3: return format("XOR V%X, V%X", x, y);
+                case 0x4: return format("ADD V%X, V%X", x, y);
+                case 0x5: return format("SUB V%X, V%X", x, y);
+                case 0x6: return format("SHR V%X, 1", x);
+                case 0x7: return format("SUBN V%X, V%X", x, y);
+                case 0xE: return format("SHL V%X, 1", x);
+            }
+        } break;
+
+        case 0x9:
+        {
+            if(n == 0x0) return format("SNE V%X, V%X", x, y);
+        } break;
+
+        case 0xA: return format("LD index, 0x%03X", nnn);
+        case 0xB: return format("JP V0, 0x%03X", nnn);
+        case 0xC: return format("RND V%X, 0x%02X", x, kk);
+        case 0xD: return format("DRW V%X, V%X, %u", x, y, n);
+
+        case 0xE:
+        {
+            if(kk == 0x9E) return format("SKP V%X", x);
+            if(kk == 0xA1) return format("SKNP V%X", x);
+        } break;
+
+        case 0xF:
+        {
+            // LD index, nnnn takes its address from the next 2 bytes,
+            // which are not part of the opcode.
+            if(opcode == 0xF000u) return "LD index, nnnn";
+            if(opcode == 0xF002u) return "AUDIO";
+
+            switch (kk)
+            {
+                case 0x01: return format("PLANE %u", x);
+                case 0x07: return format("LD V%X, DT", x);
+                case 0x0A: return format("LD V%X, K", x);
+                case 0x15: return format("LD DT, V%X", x);
+                case 0x18: return format("LD ST, V%X", x);
+                case 0x1E: return format("ADD index, V%X", x);
+                case 0x29: return format("LD F, V%X", x);
+                case 0x30: return format("LD HF, V%X", x);
+                case 0x33: return format("LD B, V%X", x);
+                case 0x3A: return format("PITCH V%X", x);
+                case 0x55: return format("LD [index], V%X", x);
+                case 0x65: return format("LD V%X, [index]", x);
+                case 0x75: return format("LD R, V%X", x);
+                case 0x85: return format("LD V%X, R", x);
+            }
+        } break;
+    }
+
+    return format("DW 0x%04X", static_cast<unsigned>(opcode));
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Translate an opcode into its mnemonic, using the same notation as
+// the comments on the Chip8::op_* declarations (for example 0x8A24
+// gives "ADD VA, V2" and 0xA2F0 gives "LD index, 0x2F0"). Opcodes
+// that don't decode to any instruction are shown as raw data words
+// ("DW 0x...").
+std::string disassemble(uint16_t opcode);
@@ -0,0 +1,547 @@
+#include "GdbStub.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Size of the register block sent by 'g': V0-VF, I, PC, SP, DT, ST
+const unsigned GDB_REGISTER_BYTES = REGISTER_COUNT + 2 + 2 + 3;
+
+// Numbers of the registers for 'p' and 'P', in the same order
+const unsigned GDB_REG_INDEX = REGISTER_COUNT;
+const unsigned GDB_REG_PC = REGISTER_COUNT + 1;
+const unsigned GDB_REG_SP = REGISTER_COUNT + 2;
+const unsigned GDB_REG_DT = REGISTER_COUNT + 3;
+const unsigned GDB_REG_ST = REGISTER_COUNT + 4;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static std::string to_hex(const uint8_t* bytes, size_t count)
+{
+    std::string text;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        text += HEX_DIGITS[bytes[i] >> 4u];
+        text += HEX_DIGITS[bytes[i] & 0xFu];
+    }
+
+    return text;
+}
+
+static bool from_hex(const std::string& text, uint8_t* bytes, size_t count)
+{
+    if(text.size() < 2 * count)
+        return false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        char pair[3] = {text[2 * i], text[2 * i + 1], 0};
+        char* end;
+        bytes[i] = static_cast<uint8_t>(std::strtoul(pair, &end, 16));
+
+        if(end != pair + 2)
+            return false;
+    }
+
+    return true;
+}
+
+// Packets give numbers as "addr,length" or "type,addr,kind", in hex
+static unsigned long parse_hex(const std::string& text, size_t& position)
+{
+    char* end;
+    unsigned long value = std::strtoul(text.c_str() + position, &end, 16);
+    position = end - text.c_str();
+
+    return value;
+}
+
+GdbStub::GdbStub(Chip8& chip8, Debugger& debugger): chip8(chip8), debugger(debugger)
+{
+}
+
+GdbStub::~GdbStub()
+{
+    disconnect();
+
+    if(server >= 0)
+        close(server);
+
+    if(!unixPath.empty())
+        unlink(unixPath.c_str());
+}
+
+bool GdbStub::listen(const char* address)
+{
+    char* end;
+    long port = std::strtol(address, &end, 10);
+
+    if(*end == '\0' && port > 0 && port < 65536)
+    {
+        // A port number: TCP, on the loopback interface only, so that
+        // the machine can't be debugged from another host.
+        sockaddr_in local {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(static_cast<uint16_t>(port));
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        server = socket(AF_INET, SOCK_STREAM, 0);
+
+        if(server < 0)
+            return false;
+
+        int reuse = 1;
+        setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if(bind(server, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+            return false;
+    }
+    else
+    {
+        sockaddr_un local {};
+        local.sun_family = AF_UNIX;
+
+        if(std::strlen(address) >= sizeof(local.sun_path))
+            return false;
+
+        std::strcpy(local.sun_path, address);
+
+        // A socket left over from a previous session is replaced, but
+        // anything else at that path (a mistyped ROM...) is left alone.
+        struct stat existing;
+
+        if(lstat(address, &existing) == 0)
+        {
+            if(!S_ISSOCK(existing.st_mode))
+                return false;
+
+            unlink(address);
+        }
+
+        server = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if(server < 0 || bind(server, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+            return false;
+
+        unixPath = address;
+    }
+
+    // Accepting is polled between frames, so it must not block.
+    fcntl(server, F_SETFL, fcntl(server, F_GETFL) | O_NONBLOCK);
+
+    return ::listen(server, 1) == 0;
+}
+
+void GdbStub::poll(int timeout)
+{
+    if(client < 0)
+    {
+        client = accept(server, nullptr, nullptr);
+
+        // GDB expects the machine to be stopped when it attaches.
+        if(client >= 0)
+        {
+            isHalted = true;
+            lastStop = "S05";
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    do
+    {
+        pollfd request {client, POLLIN, 0};
+
+        if(::poll(&request, 1, isHalted ? timeout : 0) <= 0)
+            return;
+
+        char buffer[4096];
+        ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+
+        if(count <= 0)
+        {
+            disconnect();
+            return;
+        }
+
+        input.append(buffer, count);
+        process_input();
+
+    } while (isHalted && client >= 0);
+}
+
+void GdbStub::report(StopReason reason)
+{
+    if(reason == StopReason::None)
+        return;
+
+    isHalted = true;
+    lastStop = stop_reply(reason);
+
+    if(client >= 0)
+        send(lastStop);
+}
+
+void GdbStub::disconnect()
+{
+    if(client >= 0)
+        close(client);
+
+    client = -1;
+    input.clear();
+
+    // Nothing must be left to slow the machine down, or to stop it
+    // with no one to resume it.
+    debugger.clear_all();
+    isHalted = false;
+}
+
+void GdbStub::process_input()
+{
+    // The input is a stream of packets, "$data#checksum", which are
+    // acknowledged with '+' (or '-' to get them again), and of
+    // single 0x03 bytes, sent to interrupt the running machine.
+    while (!input.empty() && client >= 0)
+    {
+        if(input[0] == '\x03')
+        {
+            input.erase(0, 1);
+
+            if(!isHalted)
+            {
+                isHalted = true;
+                lastStop = "S02";
+                send(lastStop);
+            }
+
+            continue;
+        }
+
+        if(input[0] != '$')
+        {
+            // Acknowledgements of our own packets, or garbage
+            input.erase(0, 1);
+            continue;
+        }
+
+        size_t hash = input.find('#');
+
+        if(hash == std::string::npos || input.size() < hash + 3)
+            return;
+
+        std::string packet = input.substr(1, hash - 1);
+        unsigned checksum = std::strtoul(input.substr(hash + 1, 2).c_str(), nullptr, 16);
+        input.erase(0, hash + 3);
+
+        uint8_t sum = 0;
+
+        for (char c : packet)
+        {
+            sum += static_cast<uint8_t>(c);
+        }
+
+        if(sum != checksum)
+        {
+            ::send(client, "-", 1, MSG_NOSIGNAL);
+            continue;
+        }
+
+        ::send(client, "+", 1, MSG_NOSIGNAL);
+        handle(packet);
+    }
+}
+
+void GdbStub::handle(const std::string& packet)
+{
+    char command = packet.empty() ? 0 : packet[0];
+    size_t position = 1;
+
+    switch (command)
+    {
+        case '?':
+        {
+            send(lastStop);
+        } break;
+
+        case 'g':
+        {
+            uint8_t block[GDB_REGISTER_BYTES];
+            std::memcpy(block, chip8.registers, REGISTER_COUNT);
+            block[REGISTER_COUNT] = chip8.index & 0xFFu;
+            block[REGISTER_COUNT + 1] = chip8.index >> 8u;
+            block[REGISTER_COUNT + 2] = chip8.pc & 0xFFu;
+            block[REGISTER_COUNT + 3] = chip8.pc >> 8u;
+            block[REGISTER_COUNT + 4] = chip8.sp;
+            block[REGISTER_COUNT + 5] = chip8.delayTimer;
+            block[REGISTER_COUNT + 6] = chip8.soundTimer;
+
+            send(to_hex(block, sizeof(block)));
+        } break;
+
+        case 'G':
+        {
+            uint8_t block[GDB_REGISTER_BYTES];
+
+            if(!from_hex(packet.substr(1), block, sizeof(block)))
+            {
+                send("E01");
+                break;
+            }
+
+            std::memcpy(chip8.registers, block, REGISTER_COUNT);
+            chip8.index = block[REGISTER_COUNT] | (block[REGISTER_COUNT + 1] << 8u);
+            chip8.pc = block[REGISTER_COUNT + 2] | (block[REGISTER_COUNT + 3] << 8u);
+            chip8.sp = block[REGISTER_COUNT + 4];
+            chip8.delayTimer = block[REGISTER_COUNT + 5];
+            chip8.soundTimer = block[REGISTER_COUNT + 6];
+
+            send("OK");
+        } break;
+
+        case 'p':
+        case 'P':
+        {
+            unsigned reg = parse_hex(packet, position);
+            uint8_t value[2] {};
+            bool wide = (reg == GDB_REG_INDEX || reg == GDB_REG_PC);
+            size_t size = wide ? 2 : 1;
+
+            if(reg > GDB_REG_ST)
+            {
+                send("E01");
+                break;
+            }
+
+            if(command == 'P')
+            {
+                if(packet[position] != '=' || !from_hex(packet.substr(position + 1), value, size))
+                {
+                    send("E01");
+                    break;
+                }
+
+                uint16_t word = value[0] | (value[1] << 8u);
+
+                if(reg < REGISTER_COUNT) chip8.registers[reg] = value[0];
+                else if(reg == GDB_REG_INDEX) chip8.index = word;
+                else if(reg == GDB_REG_PC) chip8.pc = word;
+                else if(reg == GDB_REG_SP) chip8.sp = value[0];
+                else if(reg == GDB_REG_DT) chip8.delayTimer = value[0];
+                else chip8.soundTimer = value[0];
+
+                send("OK");
+            }
+            else
+            {
+                uint16_t word = 0;
+
+                if(reg < REGISTER_COUNT) word = chip8.registers[reg];
+                else if(reg == GDB_REG_INDEX) word = chip8.index;
+                else if(reg == GDB_REG_PC) word = chip8.pc;
+                else if(reg == GDB_REG_SP) word = chip8.sp;
+                else if(reg == GDB_REG_DT) word = chip8.delayTimer;
+                else word = chip8.soundTimer;
+
+                value[0] = word & 0xFFu;
+                value[1] = word >> 8u;
+                send(to_hex(value, size));
+            }
+        } break;
+
+        case 'm':
+        case 'M':
+        {
+            unsigned long address = parse_hex(packet, position);
+            unsigned long length = parse_hex(packet, ++position);
+
+            if(address + length > MEMORY_SIZE)
+            {
+                send("E01");
+                break;
+            }
+
+            if(command == 'm')
+            {
+                send(to_hex(chip8.memory + address, length));
+            }
+            else if(packet[position] == ':' && from_hex(packet.substr(position + 1), chip8.memory + address, length))
+            {
+                send("OK");
+            }
+            else
+            {
+                send("E01");
+            }
+        } break;
+
+        case 'c':
+        case 's':
+        {
+            // Both can be given the adress to resume from.
+            if(position < packet.size())
+                chip8.pc = parse_hex(packet, position);
+
+            if(command == 'c')
+            {
+                // The stop is reported when it happens, by report()
+                isHalted = false;
+            }
+            else
+            {
+                lastStop = stop_reply(debugger.step());
+                send(lastStop);
+            }
+        } break;
+
+        case 'Z':
+        case 'z':
+        {
+            // Z0 and Z1 (software and hardware breakpoints) are the same
+            // to us; Z2 are write watchpoints. Read and access
+            // watchpoints (Z3, Z4) are not supported.
+            unsigned type = parse_hex(packet, position);
+            unsigned long address = parse_hex(packet, ++position);
+            unsigned long length = parse_hex(packet, ++position);
+            bool set = command == 'Z';
+
+            if(type == 0 || type == 1)
+            {
+                if(set) debugger.set_breakpoint(address);
+                else debugger.clear_breakpoint(address);
+
+                send("OK");
+            }
+            else if(type == 2)
+            {
+                if(set) debugger.set_watchpoint(address, length);
+                else debugger.clear_watchpoint(address, length);
+
+                send("OK");
+            }
+            else
+            {
+                send("");
+            }
+        } break;
+
+        case 'q':
+        {
+            if(packet.rfind("qSupported", 0) == 0)
+            {
+                send("PacketSize=4000");
+            }
+            else if(packet == "qAttached")
+            {
+                send("1");
+            }
+            else if(packet.rfind("qRcmd,", 0) == 0)
+            {
+                std::string hex = packet.substr(6);
+                std::string text(hex.size() / 2, '\0');
+
+                if(from_hex(hex, reinterpret_cast<uint8_t*>(text.data()), text.size()) && monitor(text))
+                    send("OK");
+                else
+                    send("E01");
+            }
+            else
+            {
+                send("");
+            }
+        } break;
+
+        case 'H':
+        {
+            // There is only one thread.
+            send("OK");
+        } break;
+
+        case 'D':
+        {
+            send("OK");
+            disconnect();
+        } break;
+
+        case 'k':
+        {
+            // Killing the session only detaches: the emulator itself
+            // goes on.
+            disconnect();
+        } break;
+
+        default:
+        {
+            // An empty reply means "not supported".
+            send("");
+        } break;
+    }
+}
+
+bool GdbStub::monitor(const std::string& command)
+{
+    // "watch <register>" or "unwatch <register>", the register being
+    // V0 to VF or I.
+    char action[16], name[8];
+
+    if(std::sscanf(command.c_str(), "%15s %7s", action, name) != 2)
+        return false;
+
+    bool watch = std::strcmp(action, "watch") == 0;
+
+    if(!watch && std::strcmp(action, "unwatch") != 0)
+        return false;
+
+    unsigned reg;
+
+    if((name[0] == 'I' || name[0] == 'i') && name[1] == '\0')
+        reg = WATCH_INDEX;
+    else if((name[0] == 'V' || name[0] == 'v') && std::strlen(name) == 2 && std::isxdigit(name[1]))
+        reg = std::strtoul(name + 1, nullptr, 16);
+    else
+        return false;
+
+    debugger.watch_register(reg, watch);
+
+    return true;
+}
+
+void GdbStub::send(const std::string& data)
+{
+    uint8_t sum = 0;
+
+    for (char c : data)
+    {
+        sum += static_cast<uint8_t>(c);
+    }
+
+    char checksum[4];
+    std::snprintf(checksum, sizeof(checksum), "#%02x", sum);
+
+    std::string packet = "$" + data + checksum;
+    ::send(client, packet.data(), packet.size(), MSG_NOSIGNAL);
+}
+
+std::string GdbStub::stop_reply(StopReason reason)
+{
+    if(reason == StopReason::Watchpoint)
+    {
+        char reply[32];
+        std::snprintf(reply, sizeof(reply), "T05watch:%x;", debugger.watch_hit());
+
+        return reply;
+    }
+
+    // SIGTRAP, for breakpoints, register watchpoints and steps
+    return "S05";
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+
+// A stub for the GDB remote serial protocol, so that the machine can be
+// debugged from GDB or any other client speaking the protocol, over TCP
+// on localhost or over a Unix socket. The registers, as sent by 'g', are
+// V0 to VF (1 byte each), the index and the PC (2 bytes each, little
+// endian), then SP, DT and ST (1 byte each). Memory adresses are those
+// of the CHIP-8 memory. Besides breakpoints (Z0/Z1), write watchpoints
+// (Z2) and single-stepping, register watchpoints are available through
+// monitor commands: "monitor watch V3", "monitor unwatch I"...
+//
+// The stub is driven by the emulation thread, between frames; there is
+// no thread of its own. It is only available on POSIX systems.
+class GdbStub
+{
+    public:
+
+        GdbStub(Chip8& chip8, Debugger& debugger);
+        ~GdbStub();
+
+        // Listen on 'address': a port number for TCP on localhost, or
+        // else the path of a Unix socket, which must not exist unless as
+        // a socket (replaced then). Returns false on failure.
+        bool listen(const char* address);
+
+        // Accept a client and handle its requests, without blocking while
+        // the machine runs; while it is stopped, keep waiting for requests
+        // for up to 'timeout' milliseconds.
+        void poll(int timeout);
+
+        // Whether the client stopped the machine, in which case the
+        // frontend must not run it.
+        bool halted() const { return isHalted; }
+
+        // Tell the client why the debugger stopped the machine.
+        void report(StopReason reason);
+
+    private:
+
+        Chip8& chip8;
+        Debugger& debugger;
+
+        int server = -1, client = -1;
+        std::string unixPath;
+        std::string input;
+        bool isHalted = false;
+        std::string lastStop = "S05";
+
+        void disconnect();
+        void process_input();
+        void handle(const std::string& packet);
+        void send(const std::string& data);
+        std::string stop_reply(StopReason reason);
+        bool monitor(const std::string& command);
+};
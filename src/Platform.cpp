@@ -1,8 +1,39 @@
 
 #include "Platform.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+const int AUDIO_FREQUENCY = 44100;
+const int AUDIO_SAMPLES = 256; // ~6 ms per callback at 44.1 kHz
+const float BEEP_FREQUENCY = 440.0f;
+const float BEEP_VOLUME = 0.1f;
+
+// Font of the overlay: 3x5 dots, a row per number, the leftmost dot in
+// bit 2. Characters without a glyph are left blank.
+const char OVERLAY_CHARACTERS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.%/-:";
+const uint8_t overlayFont[sizeof(OVERLAY_CHARACTERS) - 1][5] =
+{
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, // 0-3
+    {5, 5, 7, 1, 1}, {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, // 4-7
+    {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}, {2, 5, 7, 5, 5}, {6, 5, 6, 5, 6}, // 8-B
+    {7, 4, 4, 4, 7}, {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7}, {7, 4, 6, 4, 4}, // C-F
+    {7, 4, 5, 5, 7}, {5, 5, 7, 5, 5}, {7, 2, 2, 2, 7}, {1, 1, 1, 5, 7}, // G-J
+    {5, 5, 6, 5, 5}, {4, 4, 4, 4, 7}, {5, 7, 7, 5, 5}, {6, 5, 5, 5, 5}, // K-N
+    {2, 5, 5, 5, 2}, {7, 5, 7, 4, 4}, {2, 5, 5, 6, 3}, {6, 5, 6, 5, 5}, // O-R
+    {3, 4, 2, 1, 6}, {7, 2, 2, 2, 2}, {5, 5, 5, 5, 7}, {5, 5, 5, 5, 2}, // S-V
+    {5, 5, 7, 7, 5}, {5, 5, 2, 5, 5}, {5, 5, 2, 2, 2}, {7, 1, 2, 4, 7}, // W-Z
+    {0, 0, 0, 0, 2}, {5, 1, 2, 4, 5}, {1, 1, 2, 4, 4}, {0, 0, 7, 0, 0}, // . % / -
+    {0, 2, 0, 2, 0}                                                     // :
+};
+
 Platform::Platform(const char* title, unsigned windowWidth, unsigned windowHeight,
                    unsigned textureWidth, unsigned textureHeight)
+    : textureWidth(textureWidth), textureHeight(textureHeight)
 {
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -10,213 +41,244 @@ Platform::Platform(const char* title, unsigned windowWidth, unsigned windowHeigh
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
                                 SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+
+    // The overlay's background is translucent.
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    // The buzzer is a square wave, generated in the audio callback. A
+    // small buffer keeps the delay between the sound timer being set
+    // and the sound being heard well under a frame. Not having audio
+    // (no device, or SDL_AUDIODRIVER=dummy) is not an error.
+    SDL_AudioSpec wanted {}, obtained {};
+    wanted.freq = AUDIO_FREQUENCY;
+    wanted.format = AUDIO_F32SYS;
+    wanted.channels = 1;
+    wanted.samples = AUDIO_SAMPLES;
+    wanted.callback = audio_callback;
+    wanted.userdata = this;
+
+    if(SDL_InitSubSystem(SDL_INIT_AUDIO) == 0)
+        audioDevice = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, 0);
+
+    if(audioDevice)
+    {
+        sampleRate = obtained.freq;
+        SDL_PauseAudioDevice(audioDevice, 0);
+    }
+    else
+    {
+        std::cerr << "No audio: " << SDL_GetError() << "\n";
+    }
+}
+
+void Platform::audio_callback(void* userdata, Uint8* stream, int length)
+{
+    Platform& platform = *static_cast<Platform*>(userdata);
+    float* samples = reinterpret_cast<float*>(stream);
+    int count = length / sizeof(float);
+
+    // The tone follows the latest sound timer value, as of this chunk,
+    // so that the sound never lags behind. A beep that started since the
+    // last chunk starts right away, and lasts for at least one frame
+    // worth of samples, even if the timer is already back to 0.
+    if(platform.soundStarted.exchange(false, std::memory_order_relaxed))
+        platform.samplesLeft = platform.sampleRate / 60;
+
+    bool soundOn = platform.latestSound.load(std::memory_order_relaxed) > 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        bool beeping = soundOn || platform.samplesLeft > 0;
+
+        if(platform.samplesLeft > 0)
+            --platform.samplesLeft;
+
+        // Square wave: high for the first half of each period, low for
+        // the second.
+        samples[i] = beeping ? (platform.phase < 0.5f ? BEEP_VOLUME : -BEEP_VOLUME) : 0.0f;
+
+        platform.phase += BEEP_FREQUENCY / platform.sampleRate;
+        if(platform.phase >= 1.0f)
+            platform.phase -= 1.0f;
+    }
 }
 
 Platform::~Platform()
 {
+    if(audioDevice)
+        SDL_CloseAudioDevice(audioDevice);
+
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
-void Platform::update(void const* buffer, int pitch)
+void Platform::update(void const* buffer, unsigned width, unsigned height)
 {
-    SDL_UpdateTexture(texture, nullptr, buffer, pitch);
+    if(width != textureWidth || height != textureHeight)
+    {
+        SDL_DestroyTexture(texture);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                    SDL_TEXTUREACCESS_STREAMING, width, height);
+        textureWidth = width;
+        textureHeight = height;
+    }
+
+    SDL_UpdateTexture(texture, nullptr, buffer, width * sizeof(uint32_t));
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+
+    if(overlayShown && !overlayText.empty())
+        draw_overlay();
+
     SDL_RenderPresent(renderer);
 }
 
-bool Platform::process_input(uint8_t* keys)
+void Platform::draw_overlay()
 {
-    bool quit = false;
+    // Dots are a 160th of the window's height, so that the text keeps
+    // the same size relative to the display whatever the scale.
+    int outputWidth, outputHeight;
+    SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    int dot = std::max(outputHeight / 160, 1);
 
-    SDL_Event event;
+    // Characters are 4 dots apart, lines 7, with a margin of 2 around.
+    int x = 2 * dot, y = 2 * dot, right = x;
+    overlayDots.clear();
 
-    while (SDL_PollEvent(&event))
+    for (char c : overlayText)
     {
-        switch (event.type)
+        if(c == '\n')
         {
-            case SDL_QUIT:
-            {
-                quit = true;
-            } break;
+            x = 2 * dot;
+            y += 7 * dot;
+            continue;
+        }
 
-            case SDL_KEYDOWN:
+        const char* found = std::strchr(OVERLAY_CHARACTERS, std::toupper(static_cast<unsigned char>(c)));
+
+        if(c != '\0' && found)
+        {
+            const uint8_t* glyph = overlayFont[found - OVERLAY_CHARACTERS];
+
+            for (int row = 0; row < 5; ++row)
             {
-                switch (event.key.keysym.sym)
+                for (int column = 0; column < 3; ++column)
                 {
-                    case SDLK_ESCAPE:
-                    {
-                        quit = true;
-                    } break;
-
-                    case SDLK_x:
-                    {
-                        keys[0] = 1;
-                    } break;
+                    if(glyph[row] & (4u >> column))
+                        overlayDots.push_back({x + column * dot, y + row * dot, dot, dot});
+                }
+            }
+        }
 
-                    case SDLK_1:
-                    {
-                        keys[1] = 1;
-                    } break;
+        x += 4 * dot;
+        right = std::max(right, x);
+    }
 
-                    case SDLK_2:
-                    {
-                        keys[2] = 1;
-                    } break;
+    SDL_Rect background {0, 0, right + dot, y + 7 * dot};
 
-                    case SDLK_3:
-                    {
-                        keys[3] = 1;
-                    } break;
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &background);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    SDL_RenderFillRects(renderer, overlayDots.data(), static_cast<int>(overlayDots.size()));
 
-                    case SDLK_q:
-                    {
-                        keys[4] = 1;
-                    } break;
+    // Back to the color SDL_RenderClear() fills the next frame with.
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
 
-                    case SDLK_w:
-                    {
-                        keys[5] = 1;
-                    } break;
+void Platform::wait_input(int timeout)
+{
+    // Passing no event only waits for one, leaving it in the queue
+    // for process_input().
+    SDL_WaitEventTimeout(nullptr, timeout);
+}
 
-                    case SDLK_e:
-                    {
-                        keys[6] = 1;
-                    } break;
+void Platform::set_title(const char* title)
+{
+    SDL_SetWindowTitle(window, title);
+}
 
-                    case SDLK_a:
-                    {
-                        keys[7] = 1;
-                    } break;
+bool Platform::load_keymap(const char* filename)
+{
+    // The file lists the 16 SDL key names (as in SDL_GetKeyName, for
+    // example "X", "1", "Keypad 7" has to be written "Keypad_7") for
+    // the CHIP-8 keys 0 through F, separated by whitespace.
+    std::ifstream file {filename};
+    std::array<SDL_Keycode, KEYMAP_SIZE> table {};
 
-                    case SDLK_s:
-                    {
-                        keys[8] = 1;
-                    } break;
+    for (auto& key : table)
+    {
+        std::string name;
 
-                    case SDLK_d:
-                    {
-                        keys[9] = 1;
-                    } break;
+        if(!(file >> name))
+            return false;
 
-                    case SDLK_z:
-                    {
-                        keys[0xA] = 1;
-                    } break;
+        std::replace(name.begin(), name.end(), '_', ' ');
+        key = SDL_GetKeyFromName(name.c_str());
 
-                    case SDLK_c:
-                    {
-                        keys[0xB] = 1;
-                    } break;
+        if(key == SDLK_UNKNOWN)
+            return false;
+    }
 
-                    case SDLK_4:
-                    {
-                        keys[0xC] = 1;
-                    } break;
+    keymap = table;
+    return true;
+}
 
-                    case SDLK_r:
-                    {
-                        keys[0xD] = 1;
-                    } break;
+bool Platform::process_input(std::vector<KeypadEvent>& events)
+{
+    bool quit = false;
 
-                    case SDLK_f:
-                    {
-                        keys[0xE] = 1;
-                    } break;
+    SDL_Event event;
 
-                    case SDLK_v:
-                    {
-                        keys[0xF] = 1;
-                    } break;
-                }
+    while (SDL_PollEvent(&event))
+    {
+        switch (event.type)
+        {
+            case SDL_QUIT:
+            {
+                quit = true;
             } break;
 
+            case SDL_KEYDOWN:
             case SDL_KEYUP:
             {
-                switch (event.key.keysym.sym)
-                {
-                    case SDLK_x:
-                    {
-                        keys[0] = 0;
-                    } break;
-
-                    case SDLK_1:
-                    {
-                        keys[1] = 0;
-                    } break;
+                bool pressed = event.type == SDL_KEYDOWN;
+                SDL_Keycode key = event.key.keysym.sym;
 
-                    case SDLK_2:
-                    {
-                        keys[2] = 0;
-                    } break;
-
-                    case SDLK_3:
-                    {
-                        keys[3] = 0;
-                    } break;
-
-                    case SDLK_q:
-                    {
-                        keys[4] = 0;
-                    } break;
-
-                    case SDLK_w:
-                    {
-                        keys[5] = 0;
-                    } break;
-
-                    case SDLK_e:
-                    {
-                        keys[6] = 0;
-                    } break;
-
-                    case SDLK_a:
-                    {
-                        keys[7] = 0;
-                    } break;
-
-                    case SDLK_s:
-                    {
-                        keys[8] = 0;
-                    } break;
-
-                    case SDLK_d:
-                    {
-                        keys[9] = 0;
-                    } break;
-
-                    case SDLK_z:
-                    {
-                        keys[0xA] = 0;
-                    } break;
-
-                    case SDLK_c:
-                    {
-                        keys[0xB] = 0;
-                    } break;
-
-                    case SDLK_4:
-                    {
-                        keys[0xC] = 0;
-                    } break;
-
-                    case SDLK_r:
-                    {
-                        keys[0xD] = 0;
-                    } break;
+                if(pressed && key == SDLK_ESCAPE)
+                {
+                    quit = true;
+                }
+                else if(pressed && key == SDLK_TAB)
+                {
+                    // Ignore auto-repeat, or holding the key
+                    // would keep toggling fast-forward.
+                    if(!event.key.repeat)
+                        fastForward = !fastForward;
+                }
+                else if(pressed && key == SDLK_F3)
+                {
+                    if(!event.key.repeat)
+                        overlayShown = !overlayShown;
+                }
+                else
+                {
+                    // Look the key up in the keymap, and report the new
+                    // keypad state if it changed (auto-repeat doesn't).
+                    auto found = std::find(keymap.begin(), keymap.end(), key);
 
-                    case SDLK_f:
+                    if(found != keymap.end())
                     {
-                        keys[0xE] = 0;
-                    } break;
+                        uint16_t bit = 1u << (found - keymap.begin());
+                        uint16_t state = pressed ? (keys | bit) : (keys & ~bit);
 
-                    case SDLK_v:
-                    {
-                        keys[0xF] = 0;
-                    } break;
+                        if(state != keys)
+                        {
+                            keys = state;
+                            events.push_back({event.key.timestamp, keys});
+                        }
+                    }
                 }
             } break;
         }
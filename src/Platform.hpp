@@ -1,9 +1,24 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <string>
 #include <string_view>
+#include <vector>
 #include <SDL2/SDL.h>
 
+const unsigned KEYMAP_SIZE = 16;
+
+// A change of the keypad state as seen by the platform: 'timestamp' is
+// when it happened, in SDL ticks (milliseconds), and bit i of 'keys' is
+// set while CHIP-8 key i is held.
+struct KeypadEvent
+{
+    uint32_t timestamp;
+    uint16_t keys;
+};
+
 class Platform
 {
     public:
@@ -13,12 +28,91 @@ class Platform
 
         ~Platform();
 
-        void update(const void* buffer, int pitch);
-        bool process_input(uint8_t* keys);
+        // Show a frame of RGBA pixels; the texture follows its
+        // resolution, which the program may change (64x32 or 128x64),
+        // and is stretched to the window.
+        void update(const void* buffer, unsigned width, unsigned height);
+        // Handle the pending SDL events, appending every change of the
+        // keypad state to 'events'; returns true when asked to quit.
+        bool process_input(std::vector<KeypadEvent>& events);
+
+        // Replace the default keymap (1234/QWER/ASDF/ZXCV) with the one
+        // in 'filename'; returns false, keeping the current one, if the
+        // file can't be read.
+        bool load_keymap(const char* filename);
+
+        // Milliseconds since initialization, on the same clock as the
+        // input event timestamps; callable from any thread.
+        static uint32_t ticks() { return SDL_GetTicks(); }
+
+        // Sleep until an input event is available or 'timeout'
+        // milliseconds have passed.
+        void wait_input(int timeout);
+
+        void set_title(const char* title);
+
+        // Whether fast-forward is on; Tab toggles it.
+        bool fast_forward() const { return fastForward; }
+
+        // Text drawn over the frames, in lines separated by '\n', while
+        // the overlay is shown; F3 toggles it.
+        void set_overlay(std::string text) { overlayText = std::move(text); }
+        void show_overlay(bool shown) { overlayShown = shown; }
+        bool overlay_shown() const { return overlayShown; }
+
+        // Feed the sound timer value at the end of each emulated frame;
+        // a tone plays while it is non-zero. This is the one method that
+        // can be called from the emulation thread: it only stores the
+        // value for the audio callback, without locking.
+        void push_sound(uint8_t soundTimer)
+        {
+            latestSound.store(soundTimer, std::memory_order_relaxed);
+
+            if(soundTimer)
+                soundStarted.store(true, std::memory_order_relaxed);
+        }
 
     private:
 
         SDL_Window* window;
         SDL_Renderer* renderer;
         SDL_Texture* texture;
+        unsigned textureWidth, textureHeight;
+
+        bool fastForward = false;
+
+        // The overlay is drawn with a small built-in font, each dot of it
+        // a rectangle, all filled at once.
+        std::string overlayText;
+        bool overlayShown = false;
+        std::vector<SDL_Rect> overlayDots;
+
+        void draw_overlay();
+
+        // Keys of the host keyboard for the CHIP-8 keys 0 through F, and
+        // which of them are held.
+        std::array<SDL_Keycode, KEYMAP_SIZE> keymap
+        {
+            SDLK_x, SDLK_1, SDLK_2, SDLK_3,
+            SDLK_q, SDLK_w, SDLK_e, SDLK_a,
+            SDLK_s, SDLK_d, SDLK_z, SDLK_c,
+            SDLK_4, SDLK_r, SDLK_f, SDLK_v
+        };
+        uint16_t keys = 0;
+
+        // Audio is produced in small chunks by SDL's audio thread, which
+        // calls 'audio_callback' and plays the latest sound timer value
+        // in each. As the emulation may run ahead (or fast-forward),
+        // values in between are dropped, but a beep that started since
+        // the last chunk is still heard, for at least 1/60 s
+        // ('samplesLeft' of it remain).
+        // The device is 0 if no audio could be opened, in which case the
+        // emulator stays silent.
+        static void audio_callback(void* userdata, Uint8* stream, int length);
+
+        SDL_AudioDeviceID audioDevice = 0;
+        std::atomic<uint8_t> latestSound {0};
+        std::atomic<bool> soundStarted {false};
+        int sampleRate = 0, samplesLeft = 0;
+        float phase = 0;
 };
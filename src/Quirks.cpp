@@ -0,0 +1,61 @@
+#include "Quirks.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+bool parse_quirk_profile(const std::string& name, QuirkProfile& profile)
+{
+    if(name == "modern")
+        profile = QuirkProfile::Modern;
+    else if(name == "vip")
+        profile = QuirkProfile::CosmacVip;
+    else if(name == "schip")
+        profile = QuirkProfile::SuperChip;
+    else if(name == "xochip")
+        profile = QuirkProfile::XoChip;
+    else
+        return false;
+
+    return true;
+}
+
+uint64_t rom_hash(const char* filename)
+{
+    std::ifstream file {filename, std::ios::binary};
+
+    if(!file.is_open())
+        return 0;
+
+    // FNV-1a: for each byte, XOR it into the hash, then multiply by
+    // the FNV prime.
+    uint64_t hash = 0xCBF29CE484222325u;
+
+    for (auto it = std::istreambuf_iterator<char>(file); it != std::istreambuf_iterator<char>(); ++it)
+    {
+        hash ^= static_cast<uint8_t>(*it);
+        hash *= 0x100000001B3u;
+    }
+
+    return hash;
+}
+
+bool find_quirk_profile(const char* database, uint64_t hash, QuirkProfile& profile)
+{
+    std::ifstream file {database};
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields {line};
+        uint64_t entry;
+        std::string name;
+
+        if(fields >> std::hex >> entry >> name && entry == hash)
+            return parse_quirk_profile(name, profile);
+    }
+
+    return false;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// The CHIP-8 was reimplemented many times, and the implementations
+// disagree on a handful of instructions ("quirks"); programs written for
+// one may not run on another. A quirk profile gathers the choices of one
+// implementation as compile-time constants: the instructions affected
+// are templates over the profile, so each profile gets its own version
+// of them, with no runtime test of the quirks (see Chip8::set_quirks).
+//  - shiftUsesVy: SHR/SHL (8xy6, 8xyE) shift Vy into Vx, instead of
+//  shifting Vx in place;
+//  - indexIncrements: LD [index], Vx and LD Vx, [index] (Fx55, Fx65)
+//  leave the index pointing after the last register transfered;
+//  - jumpUsesVx: Bnnn jumps to xnn + Vx (x being the first digit of
+//  nnn) instead of nnn + V0;
+//  - logicResetsVF: OR, AND and XOR (8xy1-3) set VF to 0;
+//  - clipSprites: DRW (Dxyn) clips sprites at the edges of the screen
+//  instead of wrapping them around to the other side.
+
+// The behavior this emulator always had, which most recent ROMs expect.
+struct ModernQuirks
+{
+    static constexpr bool shiftUsesVy = false;
+    static constexpr bool indexIncrements = false;
+    static constexpr bool jumpUsesVx = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool clipSprites = false;
+};
+
+// The original COSMAC VIP interpreter.
+struct CosmacVipQuirks
+{
+    static constexpr bool shiftUsesVy = true;
+    static constexpr bool indexIncrements = true;
+    static constexpr bool jumpUsesVx = false;
+    static constexpr bool logicResetsVF = true;
+    static constexpr bool clipSprites = true;
+};
+
+// CHIP-48 and SUPER-CHIP, on HP-48 calculators.
+struct SuperChipQuirks
+{
+    static constexpr bool shiftUsesVy = false;
+    static constexpr bool indexIncrements = false;
+    static constexpr bool jumpUsesVx = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool clipSprites = true;
+};
+
+// The XO-CHIP, as implemented by Octo.
+struct XoChipQuirks
+{
+    static constexpr bool shiftUsesVy = true;
+    static constexpr bool indexIncrements = true;
+    static constexpr bool jumpUsesVx = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool clipSprites = false;
+};
+
+// To choose a profile at runtime.
+enum class QuirkProfile
+{
+    Modern,
+    CosmacVip,
+    SuperChip,
+    XoChip
+};
+
+// Profile names are "modern", "vip", "schip" and "xochip"; returns false if
+// 'name' is none of them.
+bool parse_quirk_profile(const std::string& name, QuirkProfile& profile);
+
+// 64-bit FNV-1a hash of the contents of a ROM file (0 if it can't be
+// read), which identifies it in the quirks database.
+uint64_t rom_hash(const char* filename);
+
+// Look a ROM hash up in a quirks database: a text file where each line
+// holds a hash, in hexadecimal, and the name of the profile the ROM
+// needs; '#' starts a comment. Returns false if the ROM isn't listed
+// (or the database can't be read), leaving 'profile' as it was.
+bool find_quirk_profile(const char* database, uint64_t hash, QuirkProfile& profile);
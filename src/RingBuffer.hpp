@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// A fixed-size queue between exactly one producer thread and one
+// consumer thread, without locks: the producer only ever writes 'tail'
+// and the consumer only ever writes 'head', so each side just has to
+// publish its own position (release) and read the other's (acquire).
+// 'Capacity' must be a power of two; one slot is kept free to tell a
+// full queue from an empty one.
+template<typename T, size_t Capacity>
+class RingBuffer
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+
+        // Producer side: returns false, dropping the value, if the
+        // queue is full.
+        bool push(const T& value)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t next = (t + 1) & (Capacity - 1);
+
+            if(next == head.load(std::memory_order_acquire))
+                return false;
+
+            items[t] = value;
+            tail.store(next, std::memory_order_release);
+
+            return true;
+        }
+
+        // Consumer side: returns false if the queue is empty.
+        bool pop(T& value)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+
+            if(h == tail.load(std::memory_order_acquire))
+                return false;
+
+            value = items[h];
+            head.store((h + 1) & (Capacity - 1), std::memory_order_release);
+
+            return true;
+        }
+
+        // Number of values waiting; exact only from the consumer side.
+        size_t size() const
+        {
+            return (tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed)) & (Capacity - 1);
+        }
+
+    private:
+
+        T items[Capacity] {};
+        std::atomic<size_t> head {0}, tail {0};
+};
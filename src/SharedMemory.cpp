@@ -0,0 +1,133 @@
+#include "SharedMemory.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Number of times a reader retries before giving up on a frame
+const unsigned SHARED_READ_ATTEMPTS = 64;
+
+SharedPublisher::~SharedPublisher()
+{
+    if(state)
+    {
+        munmap(state, sizeof(SharedState));
+        shm_unlink(name.c_str());
+    }
+}
+
+bool SharedPublisher::open(const char* segment)
+{
+    // Never attach to an existing segment: two emulators publishing to
+    // the same one would break each other's sequence counts.
+    int fd = shm_open(segment, O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if(fd < 0)
+        return false;
+
+    bool ok = ftruncate(fd, sizeof(SharedState)) == 0;
+    void* memory = ok ? mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if(memory == MAP_FAILED)
+    {
+        shm_unlink(segment);
+        return false;
+    }
+
+    // The memory comes zeroed; construct the atomics in place, and
+    // write the magic last so that readers only see a complete header.
+    state = new (memory) SharedState {};
+    state->version = SHARED_VERSION;
+    state->width = LORES_WIDTH;
+    state->height = LORES_HEIGHT;
+    std::atomic_thread_fence(std::memory_order_release);
+    state->magic = SHARED_MAGIC;
+
+    name = segment;
+
+    return true;
+}
+
+void SharedPublisher::publish(const Chip8& chip8, uint64_t frame)
+{
+    // Odd sequence: writing...
+    uint64_t sequence = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    state->frame = frame;
+    state->delayTimer = chip8.delayTimer;
+    state->soundTimer = chip8.soundTimer;
+    state->width = chip8.videoWidth;
+    state->height = chip8.videoHeight;
+    std::memcpy(state->video, chip8.video, chip8.videoWidth * chip8.videoHeight * sizeof(uint32_t));
+
+    // ...even again: done.
+    state->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+SharedReader::~SharedReader()
+{
+    if(state)
+        munmap(state, sizeof(SharedState));
+}
+
+bool SharedReader::attach(const char* segment)
+{
+    int fd = shm_open(segment, O_RDWR, 0);
+
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(SharedState));
+    void* memory = ok ? mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if(memory == MAP_FAILED)
+        return false;
+
+    state = static_cast<SharedState*>(memory);
+
+    if(state->magic != SHARED_MAGIC || state->version != SHARED_VERSION)
+    {
+        munmap(memory, sizeof(SharedState));
+        state = nullptr;
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return true;
+}
+
+bool SharedReader::read(SharedSnapshot& snapshot) const
+{
+    for (unsigned attempt = 0; attempt < SHARED_READ_ATTEMPTS; ++attempt)
+    {
+        uint64_t before = state->sequence.load(std::memory_order_acquire);
+
+        if(before & 1u)
+            continue;
+
+        snapshot.frame = state->frame;
+        snapshot.delayTimer = state->delayTimer;
+        snapshot.soundTimer = state->soundTimer;
+        snapshot.width = state->width;
+        snapshot.height = state->height;
+        // The size is checked, as it may be torn like the rest.
+        if(snapshot.width * snapshot.height <= VIDEO_WIDTH * VIDEO_HEIGHT)
+            std::memcpy(snapshot.video, state->video, snapshot.width * snapshot.height * sizeof(uint32_t));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(state->sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+
+    return false;
+}
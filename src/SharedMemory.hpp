@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "Chip8.hpp"
+
+// Shared-memory export of a running machine: the emulator publishes its
+// display and timers into a POSIX shared-memory segment once per frame,
+// and reads the keypad state from it, so that other processes (dashboards,
+// recorders, agents...) can watch and play without going through sockets
+// or the emulator's window. The publisher is the emulator; other programs
+// use SharedReader.
+//
+// The display and timers are protected by a sequence lock: 'sequence' is
+// odd while the publisher is writing, and readers retry if it was odd or
+// changed while they were copying. The keypad goes the other way and is a
+// single atomic.
+
+const uint32_t SHARED_MAGIC = 0x48533843u; // "C8SH"
+const uint32_t SHARED_VERSION = 2;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared atomics must be lock-free to work across processes");
+static_assert(std::atomic<uint16_t>::is_always_lock_free, "Shared atomics must be lock-free to work across processes");
+
+// Layout of the segment
+struct SharedState
+{
+    uint32_t magic, version;
+
+    std::atomic<uint64_t> sequence;
+
+    // Written by the publisher, under the sequence lock; the display
+    // is 'width' x 'height' pixels, row after row, in the resolution
+    // the program is using.
+    uint64_t frame;
+    uint8_t delayTimer, soundTimer;
+    uint32_t width, height;
+    uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT];
+
+    // Written by the readers: bit i set while key i is held
+    std::atomic<uint16_t> keypad;
+};
+
+// A consistent copy of what was published
+struct SharedSnapshot
+{
+    uint64_t frame;
+    uint8_t delayTimer, soundTimer;
+    uint32_t width, height;
+    uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT];
+};
+
+class SharedPublisher
+{
+    public:
+
+        SharedPublisher() = default;
+        ~SharedPublisher();
+
+        // Create the segment 'name' (which, for POSIX, starts with a
+        // slash, as in "/chip8"). Returns false on failure, with errno
+        // set to EEXIST if the segment already exists.
+        bool open(const char* name);
+
+        // Publish the display and timers of a frame
+        void publish(const Chip8& chip8, uint64_t frame);
+
+        // Keypad state set by the readers
+        uint16_t keypad() const { return state->keypad.load(std::memory_order_relaxed); }
+
+    private:
+
+        SharedState* state = nullptr;
+        std::string name;
+};
+
+class SharedReader
+{
+    public:
+
+        SharedReader() = default;
+        ~SharedReader();
+
+        // Attach to the segment of a running emulator. Returns false if
+        // there is none or it isn't one of ours.
+        bool attach(const char* name);
+
+        // Copy the latest published frame. Returns false if the
+        // publisher kept writing over it while we tried.
+        bool read(SharedSnapshot& snapshot) const;
+
+        // Set the keys held
+        void set_keypad(uint16_t keys) { state->keypad.store(keys, std::memory_order_relaxed); }
+
+    private:
+
+        SharedState* state = nullptr;
+};
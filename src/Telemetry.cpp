@@ -0,0 +1,295 @@
+#include "Telemetry.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+const auto REPORT_PERIOD = std::chrono::seconds(1);
+
+// Add to a counter only one thread writes to.
+static void add(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Bucket of a duration in microseconds: the values under 4 have one each,
+// then each power of two is split in 4 by the two bits after the leading
+// one.
+static unsigned bucket_of(uint64_t microseconds)
+{
+    if(microseconds < 4)
+        return static_cast<unsigned>(microseconds);
+
+    unsigned msb = std::bit_width(microseconds) - 1;
+    unsigned bucket = msb * 4 + ((microseconds >> (msb - 2)) & 3u) - 4;
+
+    return std::min(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+// Smallest duration falling in a bucket.
+static uint64_t bucket_start(unsigned bucket)
+{
+    if(bucket < 4)
+        return bucket;
+
+    unsigned msb = bucket / 4 + 1;
+
+    return static_cast<uint64_t>(4 + bucket % 4) << (msb - 2);
+}
+
+void Histogram::record(std::chrono::steady_clock::duration duration)
+{
+    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+    add(buckets[bucket_of(static_cast<uint64_t>(std::max<decltype(microseconds)>(microseconds, 0)))], 1);
+}
+
+HistogramSummary Histogram::take()
+{
+    std::array<uint64_t, HISTOGRAM_BUCKETS> counts;
+    HistogramSummary summary;
+
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        uint64_t total = buckets[i].load(std::memory_order_relaxed);
+        counts[i] = total - taken[i];
+        taken[i] = total;
+        summary.count += counts[i];
+    }
+
+    if(summary.count == 0)
+        return summary;
+
+    // A percentile is the largest value of the bucket holding the value
+    // of its rank, in increasing order.
+    auto percentile = [&counts](uint64_t rank)
+    {
+        uint64_t seen = 0;
+        unsigned i = 0;
+
+        for (; i < HISTOGRAM_BUCKETS - 1; ++i)
+        {
+            seen += counts[i];
+
+            if(seen >= rank)
+                break;
+        }
+
+        return bucket_start(i + 1) - 1;
+    };
+
+    summary.p50 = percentile((summary.count + 1) / 2);
+    summary.p99 = percentile((summary.count * 99 + 99) / 100);
+
+    return summary;
+}
+
+Telemetry::Telemetry(const char* filename): start(clock::now()), lastReport(start), startCpu(std::clock())
+{
+    if(filename)
+    {
+        this->filename = filename;
+
+        std::string_view name {filename};
+        prometheus = name.size() >= 5 && name.substr(name.size() - 5) == ".prom";
+    }
+
+    reporter = std::thread(&Telemetry::report_periodically, this);
+}
+
+Telemetry::~Telemetry()
+{
+    {
+        std::lock_guard lock {mutex};
+        done = true;
+    }
+
+    wake.notify_one();
+    reporter.join();
+
+    report();
+}
+
+void Telemetry::record_frame(uint64_t instructions)
+{
+    add(instructionCount, instructions);
+    add(frameCount, 1);
+}
+
+void Telemetry::record_frame_time(std::chrono::steady_clock::duration time)
+{
+    frameTimes.record(time);
+}
+
+void Telemetry::record_present(std::chrono::steady_clock::duration time)
+{
+    add(presentCount, 1);
+    presentTimes.record(time);
+}
+
+TelemetryStats Telemetry::stats() const
+{
+    std::lock_guard lock {mutex};
+    return latest;
+}
+
+void Telemetry::report_periodically()
+{
+    std::unique_lock lock {mutex};
+
+    while (!wake.wait_for(lock, REPORT_PERIOD, [this] { return done; }))
+    {
+        lock.unlock();
+        report();
+        lock.lock();
+    }
+}
+
+void Telemetry::report()
+{
+    auto now = clock::now();
+    std::clock_t cpu = std::clock();
+
+    uint64_t instructions = instructionCount.load(std::memory_order_relaxed);
+    uint64_t frames = frameCount.load(std::memory_order_relaxed);
+    uint64_t presents = presentCount.load(std::memory_order_relaxed);
+
+    double period = std::max(std::chrono::duration<double>(now - lastReport).count(), 1e-6);
+
+    TelemetryStats stats;
+    stats.uptime = std::chrono::duration<double>(now - start).count();
+    stats.instructionsPerSecond = (instructions - lastInstructions) / period;
+    stats.framesPerSecond = (frames - lastFrames) / period;
+    stats.presentsPerSecond = (presents - lastPresents) / period;
+    stats.frameTime = frameTimes.take();
+    stats.presentTime = presentTimes.take();
+
+    // The timers tick once per emulated frame.
+    stats.timerDrift = (frames / 60.0 - stats.uptime) * 1000;
+
+    stats.cpuSeconds = static_cast<double>(cpu - startCpu) / CLOCKS_PER_SEC;
+    stats.cpuPercent = (stats.cpuSeconds - lastCpuSeconds) / period * 100;
+
+    lastReport = now;
+    lastInstructions = instructions;
+    lastFrames = frames;
+    lastPresents = presents;
+    lastCpuSeconds = stats.cpuSeconds;
+
+    {
+        std::lock_guard lock {mutex};
+        stats.report = latest.report + 1;
+        latest = stats;
+    }
+
+    if(!filename.empty())
+        write_file(stats);
+}
+
+void Telemetry::write_file(const TelemetryStats& stats) const
+{
+    std::string temporary = filename + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "w");
+
+    if(!file)
+        return;
+
+    if(prometheus)
+    {
+        auto gauge = [file](const char* name, const char* help, double value)
+        {
+            std::fprintf(file, "# HELP chip8_%s %s\n# TYPE chip8_%s gauge\nchip8_%s %g\n", name, help, name, name, value);
+        };
+
+        auto quantiles = [file](const char* name, const char* help, const HistogramSummary& summary)
+        {
+            std::fprintf(file, "# HELP chip8_%s %s\n# TYPE chip8_%s gauge\n", name, help, name);
+            std::fprintf(file, "chip8_%s{quantile=\"0.5\"} %llu\n", name, static_cast<unsigned long long>(summary.p50));
+            std::fprintf(file, "chip8_%s{quantile=\"0.99\"} %llu\n", name, static_cast<unsigned long long>(summary.p99));
+        };
+
+        gauge("uptime_seconds", "Time since the emulator started.", stats.uptime);
+        gauge("instructions_per_second", "Emulated instructions per second.", stats.instructionsPerSecond);
+        gauge("frames_per_second", "Emulated frames per second.", stats.framesPerSecond);
+        gauge("presents_per_second", "Frames shown in the window per second.", stats.presentsPerSecond);
+        quantiles("frame_time_microseconds", "Host time to emulate a frame.", stats.frameTime);
+        quantiles("present_time_microseconds", "Host time to show a frame.", stats.presentTime);
+        gauge("timer_drift_milliseconds", "Time the emulated timers are ahead of the host clock.", stats.timerDrift);
+        gauge("cpu_percent", "Processor time used, in percent of one core.", stats.cpuPercent);
+
+        std::fprintf(file, "# HELP chip8_cpu_seconds_total Processor time used.\n"
+                           "# TYPE chip8_cpu_seconds_total counter\nchip8_cpu_seconds_total %g\n", stats.cpuSeconds);
+    }
+    else
+    {
+        std::fprintf(file,
+                     "{\n"
+                     "  \"uptime_seconds\": %g,\n"
+                     "  \"instructions_per_second\": %g,\n"
+                     "  \"frames_per_second\": %g,\n"
+                     "  \"presents_per_second\": %g,\n"
+                     "  \"frame_time_us\": {\"p50\": %llu, \"p99\": %llu},\n"
+                     "  \"present_time_us\": {\"p50\": %llu, \"p99\": %llu},\n"
+                     "  \"timer_drift_ms\": %g,\n"
+                     "  \"cpu_percent\": %g,\n"
+                     "  \"cpu_seconds\": %g\n"
+                     "}\n",
+                     stats.uptime, stats.instructionsPerSecond, stats.framesPerSecond, stats.presentsPerSecond,
+                     static_cast<unsigned long long>(stats.frameTime.p50), static_cast<unsigned long long>(stats.frameTime.p99),
+                     static_cast<unsigned long long>(stats.presentTime.p50), static_cast<unsigned long long>(stats.presentTime.p99),
+                     stats.timerDrift, stats.cpuPercent, stats.cpuSeconds);
+    }
+
+    bool written = std::fclose(file) == 0;
+
+    // Renaming replaces the previous file at once, on Windows too.
+    std::error_code error;
+
+    if(written)
+        std::filesystem::rename(temporary, filename, error);
+
+    if(!written || error)
+        std::remove(temporary.c_str());
+}
+
+// A duration in microseconds, as it reads best: "850US" or "16.7MS".
+static std::string format_duration(uint64_t microseconds)
+{
+    char text[32];
+
+    if(microseconds < 1000)
+        std::snprintf(text, sizeof(text), "%lluUS", static_cast<unsigned long long>(microseconds));
+    else
+        std::snprintf(text, sizeof(text), "%.1fMS", microseconds / 1000.0);
+
+    return text;
+}
+
+std::string telemetry_overlay(const TelemetryStats& stats)
+{
+    char text[256];
+
+    double ips = stats.instructionsPerSecond;
+    char ipsText[32];
+
+    if(ips >= 1e6)
+        std::snprintf(ipsText, sizeof(ipsText), "%.2fM", ips / 1e6);
+    else if(ips >= 1e3)
+        std::snprintf(ipsText, sizeof(ipsText), "%.1fK", ips / 1e3);
+    else
+        std::snprintf(ipsText, sizeof(ipsText), "%.0f", ips);
+
+    std::snprintf(text, sizeof(text),
+                  "IPS %s FPS %.1f\n"
+                  "FRAME %s / %s\n"
+                  "PRESENT %s / %s\n"
+                  "DRIFT %.1fMS CPU %.0f%%",
+                  ipsText, stats.framesPerSecond,
+                  format_duration(stats.frameTime.p50).c_str(), format_duration(stats.frameTime.p99).c_str(),
+                  format_duration(stats.presentTime.p50).c_str(), format_duration(stats.presentTime.p99).c_str(),
+                  stats.timerDrift, stats.cpuPercent);
+
+    return text;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Durations are kept in logarithmic buckets, 4 per power of two, so that
+// each is known to within 25%; values up to 7 us are exact, and the last
+// bucket holds everything from about 29 s (7 << 22 us).
+const unsigned HISTOGRAM_BUCKETS = 96;
+
+// Median and 99th percentile of the durations recorded over a period, in
+// microseconds: the largest value of the bucket they fall in.
+struct HistogramSummary
+{
+    uint64_t count = 0, p50 = 0, p99 = 0;
+};
+
+// Histogram of durations, recorded by one thread and summarized by
+// another without locking. The buckets only ever grow, and having a
+// single writer, they are incremented with a plain load and store rather
+// than a (much slower) atomic read-modify-write.
+class Histogram
+{
+    public:
+
+        void record(std::chrono::steady_clock::duration duration);
+
+        // Summarize what was recorded since the last call.
+        HistogramSummary take();
+
+    private:
+
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets {};
+
+        // Bucket counts at the last take().
+        std::array<uint64_t, HISTOGRAM_BUCKETS> taken {};
+};
+
+// What the emulator did over the last report period (a second), and since
+// it started.
+struct TelemetryStats
+{
+    // Number of the report, 0 until the first one.
+    uint64_t report = 0;
+    double uptime = 0;
+
+    double instructionsPerSecond = 0, framesPerSecond = 0, presentsPerSecond = 0;
+
+    // Host time taken to emulate each frame (running its instructions,
+    // capturing and publishing it), and to show one in the window.
+    HistogramSummary frameTime, presentTime;
+
+    // How far ahead of the host's clock the 60 Hz timers of the machine
+    // are, in milliseconds, since it started: it grows in fast-forward
+    // and drops when the emulation falls behind or is stopped.
+    double timerDrift = 0;
+
+    // Processor time used by the whole process, in percent of one core
+    // over the period, and in seconds since it started.
+    double cpuPercent = 0, cpuSeconds = 0;
+};
+
+// Runtime statistics of the emulator. Recording a frame or a present
+// costs a few counter increments, so collection is always on; a thread of
+// the telemetry's own turns the counts into a TelemetryStats once a
+// second, for the window's overlay, and rewrites the stats file with it
+// if there is one.
+class Telemetry
+{
+    public:
+
+        // 'filename', if not null, is rewritten with the stats after each
+        // report: in the Prometheus text format if its name ends in
+        // ".prom", in JSON otherwise. It is written to a temporary file
+        // first, then renamed over, so that readers never see half of it.
+        explicit Telemetry(const char* filename = nullptr);
+
+        // Makes a last report, so that the file has the final stats.
+        ~Telemetry();
+
+        // From the emulation thread (and only it), after each frame: the
+        // number of instructions it ran, and, for the frames that were
+        // timed, how long it took.
+        void record_frame(uint64_t instructions);
+        void record_frame_time(std::chrono::steady_clock::duration time);
+
+        // From the display thread (and only it), after each frame shown.
+        void record_present(std::chrono::steady_clock::duration time);
+
+        // The last report; callable from any thread.
+        TelemetryStats stats() const;
+
+    private:
+
+        using clock = std::chrono::steady_clock;
+
+        std::string filename;
+        bool prometheus = false;
+
+        std::atomic<uint64_t> instructionCount {0}, frameCount {0}, presentCount {0};
+        Histogram frameTimes, presentTimes;
+
+        // Only touched by the reporting thread (and the destructor, once
+        // it is gone).
+        clock::time_point start, lastReport;
+        std::clock_t startCpu;
+        uint64_t lastInstructions = 0, lastFrames = 0, lastPresents = 0;
+        double lastCpuSeconds = 0;
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        bool done = false;
+        TelemetryStats latest;
+        std::thread reporter;
+
+        void report_periodically();
+        void report();
+        void write_file(const TelemetryStats& stats) const;
+};
+
+// The stats as a few lines of text, for the overlay.
+std::string telemetry_overlay(const TelemetryStats& stats);
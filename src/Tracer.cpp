@@ -0,0 +1,190 @@
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+// Signal handlers can't take arguments, so the tracer to flush and
+// where to flush it are kept here.
+static const Tracer* signalTracer = nullptr;
+static char signalFilename[4096] {};
+static volatile std::sig_atomic_t flushRequest = 0;
+
+void Tracer::on_crash(int signal)
+{
+    if(signalTracer)
+        signalTracer->flush_on_crash(signalFilename);
+
+    // Restore the default behavior and raise the signal again so that
+    // the process still dies (and dumps core if it would have).
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void Tracer::on_flush_request(int)
+{
+    flushRequest = 1;
+}
+
+bool Tracer::flush_requested()
+{
+    if(!flushRequest)
+        return false;
+
+    flushRequest = 0;
+    return true;
+}
+
+Tracer::Tracer(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    ring.resize(size);
+    mask = size - 1;
+}
+
+Tracer::~Tracer()
+{
+    if(signalTracer != this)
+        return;
+
+    std::signal(SIGSEGV, SIG_DFL);
+    std::signal(SIGABRT, SIG_DFL);
+    std::signal(SIGFPE, SIG_DFL);
+    std::signal(SIGILL, SIG_DFL);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, SIG_DFL);
+#endif
+
+    signalTracer = nullptr;
+}
+
+size_t Tracer::copy_records(TraceRecord* records, size_t& skip) const
+{
+    // First take a copy of everything that is in the ring: the
+    // records from 'first' to 'last', oldest first, in (at most) two
+    // contiguous pieces.
+    uint64_t last = head.load(std::memory_order_acquire);
+    uint64_t first = (last > ring.size()) ? last - ring.size() : 0;
+    size_t count = last - first;
+    size_t start = first & mask;
+    size_t before = std::min(count, ring.size() - start);
+
+    std::memcpy(records, ring.data() + start, before * sizeof(TraceRecord));
+    std::memcpy(records + before, ring.data(), (count - before) * sizeof(TraceRecord));
+
+    // Then see how far the writer went in the meantime: every record
+    // it may have been writing over while we were copying is dropped.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t now = head.load(std::memory_order_relaxed);
+    uint64_t overwritten = (now >= ring.size()) ? now - ring.size() + 1 : 0;
+    skip = (overwritten > first) ? std::min<uint64_t>(overwritten - first, count) : 0;
+
+    return count;
+}
+
+static TraceHeader trace_header(uint64_t count)
+{
+    TraceHeader header {};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.count = count;
+
+    return header;
+}
+
+bool Tracer::flush(const char* filename) const
+{
+    std::vector<TraceRecord> records(ring.size());
+    size_t skip;
+    size_t count = copy_records(records.data(), skip);
+
+    std::FILE* file = std::fopen(filename, "wb");
+
+    if(!file)
+        return false;
+
+    TraceHeader header = trace_header(count - skip);
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(records.data() + skip, sizeof(TraceRecord), header.count, file) == header.count;
+    ok = (std::fclose(file) == 0) && ok;
+
+    return ok;
+}
+
+// write() may write less than asked; keep going until everything is.
+static bool write_all(int descriptor, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+
+    while (size > 0)
+    {
+#ifdef _WIN32
+        int written = _write(descriptor, bytes, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+        ssize_t written = write(descriptor, bytes, size);
+#endif
+
+        if(written <= 0)
+            return false;
+
+        bytes += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+void Tracer::flush_on_crash(const char* filename) const
+{
+    if(!crashRecords)
+        return;
+
+    size_t skip;
+    size_t count = copy_records(crashRecords.get(), skip);
+    TraceHeader header = trace_header(count - skip);
+
+#ifdef _WIN32
+    int descriptor = _open(filename, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int descriptor = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+
+    if(descriptor < 0)
+        return;
+
+    if(write_all(descriptor, &header, sizeof(header)))
+        write_all(descriptor, crashRecords.get() + skip, header.count * sizeof(TraceRecord));
+
+#ifdef _WIN32
+    _close(descriptor);
+#else
+    close(descriptor);
+#endif
+}
+
+void Tracer::install_signal_handlers(const char* filename)
+{
+    crashRecords = std::make_unique<TraceRecord[]>(ring.size());
+    signalTracer = this;
+    std::snprintf(signalFilename, sizeof(signalFilename), "%s", filename);
+
+    std::signal(SIGSEGV, on_crash);
+    std::signal(SIGABRT, on_crash);
+    std::signal(SIGFPE, on_crash);
+    std::signal(SIGILL, on_crash);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, on_flush_request);
+#endif
+}
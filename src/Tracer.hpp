@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Chip8.hpp"
+
+// The trace file starts with a small header, followed by a flat
+// array of fixed-size records, oldest first.
+const char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+const uint32_t TRACE_VERSION = 1;
+
+// Bits of TraceRecord::flags
+const uint8_t TRACE_INDEX_CHANGED = 0x1u;
+
+// A trace record describes one executed instruction: where it was
+// (pc), what it was (opcode), and what it changed. Registers are
+// stored as they are *after* the instruction, with 'changed' being
+// a bitmask of the ones that were actually written (bit i for Vi).
+// Memory writes (Fx33, Fx55 and the XO-CHIP's 5xy2) are stored as an adress and a
+// length only: their contents can be recomputed from the opcode
+// and the registers, which keeps every record at 40 bytes.
+struct TraceRecord
+{
+    uint64_t cycle;
+    uint16_t pc, opcode, index, changed;
+    uint16_t writeAddress;
+    uint8_t writeLength, flags;
+    uint8_t sp, delayTimer, soundTimer, reserved;
+    uint8_t registers[REGISTER_COUNT];
+};
+
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord is part of the trace file format");
+
+struct TraceHeader
+{
+    char magic[4];
+    uint32_t version, recordSize, reserved;
+    uint64_t count;
+};
+
+// The tracer is a "flight recorder": a ring buffer that always holds
+// the last 'capacity' executed instructions, overwriting the oldest
+// ones. Recording is done by the emulation thread only and never
+// blocks; flushing can be done from another thread because the reader
+// checks, after copying, which records the writer may have overwritten
+// in the meantime and drops them.
+class Tracer
+{
+    public:
+
+        // The capacity is rounded up to a power of two so that the
+        // ring position is a mask instead of a modulo.
+        explicit Tracer(size_t capacity = 1u << 20);
+
+        // Puts back the default signal handlers if they were installed
+        // for this tracer, so that none is left pointing to it.
+        ~Tracer();
+
+        // Called by Chip8::cycle() around the execution of each
+        // instruction; both are inline, as they run for every cycle.
+        void before(const Chip8& chip8)
+        {
+            // The PC has already been moved past the instruction
+            pc = chip8.pc - 2;
+            index = chip8.index;
+            std::memcpy(registers, chip8.registers, sizeof(registers));
+        }
+
+        void after(const Chip8& chip8)
+        {
+            uint64_t position = head.load(std::memory_order_relaxed);
+            TraceRecord& record = ring[position & mask];
+
+            record.cycle = chip8.cycleCount;
+            record.pc = pc;
+            record.opcode = chip8.opcode;
+            record.index = chip8.index;
+            record.sp = chip8.sp;
+            record.delayTimer = chip8.delayTimer;
+            record.soundTimer = chip8.soundTimer;
+            record.flags = (chip8.index != index) ? TRACE_INDEX_CHANGED : 0;
+            std::memcpy(record.registers, chip8.registers, sizeof(record.registers));
+
+            record.changed = 0;
+            for (unsigned i = 0; i < REGISTER_COUNT; ++i)
+            {
+                record.changed |= (registers[i] != chip8.registers[i]) << i;
+            }
+
+            // The instructions writing to memory all start at the
+            // index as it was before the instruction.
+            record.writeAddress = index;
+            record.writeLength = memory_write_length(chip8.opcode);
+
+            // Publish the record: a reader seeing the new head also
+            // sees its contents.
+            head.store(position + 1, std::memory_order_release);
+        }
+
+        // Write the recorded instructions to a trace file.
+        bool flush(const char* filename) const;
+
+        // Flush to 'filename' when the process crashes, and, where
+        // available, request a flush on SIGUSR1, to get a trace on
+        // demand from a running session.
+        void install_signal_handlers(const char* filename);
+
+        // Whether SIGUSR1 was received since the last call. Signal
+        // handlers can't safely do much more than set a flag, so the
+        // flush itself is up to the program's loop.
+        static bool flush_requested();
+
+    private:
+
+        std::vector<TraceRecord> ring;
+        uint64_t mask;
+        std::atomic<uint64_t> head {0};
+
+        // Where the ring is copied when flushing on a crash, allocated
+        // up front: the crash may well be in the allocator.
+        std::unique_ptr<TraceRecord[]> crashRecords;
+
+        // Copy the ring to 'records', which has room for all of it,
+        // oldest first; returns the number of records copied, of which
+        // the first 'skip' may have been overwritten while copying.
+        size_t copy_records(TraceRecord* records, size_t& skip) const;
+
+        // Flush from the crash handler, with async-signal-safe calls
+        // only.
+        void flush_on_crash(const char* filename) const;
+
+        static void on_crash(int signal);
+        static void on_flush_request(int signal);
+
+        // State of the machine before the current instruction
+        uint16_t pc {}, index {};
+        uint8_t registers[REGISTER_COUNT] {};
+};
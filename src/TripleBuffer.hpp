@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// A triple buffer passes values (here, whole frames) from one writer
+// thread to one reader thread, without locks and without either side
+// ever waiting for the other: the writer fills the 'back' buffer while
+// the reader uses the 'front' one, and the third buffer, in the middle,
+// holds the latest value published. Publishing and fetching are each a
+// single atomic exchange of the middle buffer with the writer's or the
+// reader's own. The reader always gets the most recent value, and
+// values published in between are simply dropped.
+template<typename T>
+class TripleBuffer
+{
+    public:
+
+        // Writer side: fill back(), then publish() it.
+        T& back() { return buffers[backIndex]; }
+
+        void publish()
+        {
+            // Swap the back buffer with the middle one, flagging the
+            // new middle buffer as fresh for the reader.
+            uint8_t previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+            backIndex = previous & INDEX;
+        }
+
+        // Reader side: fetch() the latest value if there is a new one
+        // (returning false otherwise), then use front().
+        bool fetch()
+        {
+            if(!(middle.load(std::memory_order_relaxed) & FRESH))
+                return false;
+
+            uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = previous & INDEX;
+
+            return true;
+        }
+
+        const T& front() const { return buffers[frontIndex]; }
+
+    private:
+
+        static const uint8_t INDEX = 0x3u;
+        static const uint8_t FRESH = 0x4u;
+
+        T buffers[3] {};
+        uint8_t backIndex = 0, frontIndex = 1;
+        std::atomic<uint8_t> middle {2};
+};
@@ -1,15 +1,47 @@
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include "Platform.hpp"
+#include "Capture.hpp"
 #include "Chip8.hpp"
+#include "Debugger.hpp"
+#include "GdbStub.hpp"
+#include "RingBuffer.hpp"
+#include "SharedMemory.hpp"
+#include "Telemetry.hpp"
+#include "Tracer.hpp"
+#include "TripleBuffer.hpp"
+
+// In fast-forward, one frame in this many is timed for the telemetry.
+const uint64_t FAST_FORWARD_TIMING_INTERVAL = 64;
+
+// Set by SIGINT and SIGTERM when running headless
+static std::atomic<bool> interrupted {false};
+
+static void on_interrupt(int)
+{
+    interrupted.store(true);
+}
 
 int main(int argc, char** argv)
 {
-    if(argc != 4)
+    if(argc < 4)
     {
-        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM> [--trace <File>] [--turbo <Speed>] [--keymap <File>]\n"
+                  << "       [--quirks <modern|vip|schip|xochip>] [--quirks-db <File>] [--gdb <Port|Socket>]\n"
+                  << "       [--headless] [--frames <Count>] [--capture <File>]\n"
+                  << "       [--shm <Name>] [--stats <File>] [--overlay]\n";
         std::exit(EXIT_FAILURE);
     }
 
@@ -17,30 +49,524 @@ int main(int argc, char** argv)
     int delay = std::stoi(argv[2]);
     const char* rom = argv[3];
 
-    Platform platform {"CHIP-8 emulator", VIDEO_WIDTH * scale, VIDEO_HEIGHT * scale, VIDEO_WIDTH, VIDEO_HEIGHT};
+    // Options come after the three mandatory arguments
+    const char* traceFile = nullptr;
+    int turbo = 0;
+    const char* keymapFile = nullptr;
+    const char* quirksName = nullptr;
+    const char* quirksDatabase = nullptr;
+    const char* gdbAddress = nullptr;
+    bool headless = false, turboGiven = false;
+    uint64_t frameLimit = 0;
+    const char* captureFile = nullptr;
+    const char* sharedName = nullptr;
+    const char* statsFile = nullptr;
+    bool overlay = false;
+
+    for (int i = 4; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--turbo") == 0 && i + 1 < argc)
+        {
+            turbo = std::stoi(argv[++i]);
+            turboGiven = true;
+        }
+        else if(std::strcmp(argv[i], "--keymap") == 0 && i + 1 < argc)
+        {
+            keymapFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc)
+        {
+            quirksName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--quirks-db") == 0 && i + 1 < argc)
+        {
+            quirksDatabase = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--gdb") == 0 && i + 1 < argc)
+        {
+            gdbAddress = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frameLimit = std::stoull(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+        {
+            captureFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc)
+        {
+            sharedName = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+        {
+            statsFile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--overlay") == 0)
+        {
+            overlay = true;
+        }
+        else
+        {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    // Headless, there is no window (and no SDL at all): the machine
+    // runs until --frames frames have been emulated or it is
+    // interrupted, typically to record it with --capture.
+    const char* title = "CHIP-8 emulator";
+    std::unique_ptr<Platform> platform;
+
+    if(!headless)
+    {
+        platform = std::make_unique<Platform>(title, LORES_WIDTH * scale, LORES_HEIGHT * scale, LORES_WIDTH, LORES_HEIGHT);
+        platform->show_overlay(overlay);
+    }
+    else
+    {
+        // Stop cleanly, finishing the capture, on Ctrl-C or a kill; this
+        // is set up first thing, so that it also holds during startup.
+        std::signal(SIGINT, on_interrupt);
+        std::signal(SIGTERM, on_interrupt);
+    }
+
+    if(keymapFile && platform && !platform->load_keymap(keymapFile))
+    {
+        std::cerr << "Invalid keymap " << keymapFile << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    // The quirk profile is the one given with --quirks, or else the
+    // one the ROM is listed with in the database, or else the modern one.
+    QuirkProfile quirks = QuirkProfile::Modern;
+
+    if(quirksDatabase)
+        find_quirk_profile(quirksDatabase, rom_hash(rom), quirks);
+
+    if(quirksName && !parse_quirk_profile(quirksName, quirks))
+    {
+        std::cerr << "Unknown quirk profile " << quirksName << "\n";
+        std::exit(EXIT_FAILURE);
+    }
 
     Chip8 chip8 {};
+    chip8.set_quirks(quirks);
     chip8.load_ROM(rom);
 
-    int pitch = sizeof(chip8.video[0]) * VIDEO_WIDTH;
+    // When tracing, the last executed instructions are written to the
+    // trace file on exit, on a crash or on demand (SIGUSR1).
+    std::unique_ptr<Tracer> tracer;
+
+    if(traceFile)
+    {
+        tracer = std::make_unique<Tracer>();
+        tracer->install_signal_handlers(traceFile);
+        chip8.tracer = tracer.get();
+    }
+
+    // With --gdb, a GDB stub waits for a debugger to attach. As long as
+    // it sets no breakpoint or watchpoint, the machine keeps running on
+    // Chip8::run(); the debugger's checked path is only used when armed.
+    Debugger debugger {chip8};
+    std::unique_ptr<GdbStub> gdbStub;
+
+    if(gdbAddress)
+    {
+#ifdef CHIP8_GDB_STUB
+        gdbStub = std::make_unique<GdbStub>(chip8, debugger);
+
+        if(!gdbStub->listen(gdbAddress))
+        {
+            std::cerr << "Cannot listen on " << gdbAddress << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+#else
+        std::cerr << "The GDB stub is not available on this platform\n";
+        std::exit(EXIT_FAILURE);
+#endif
+    }
 
-    auto lastCycle = std::chrono::high_resolution_clock::now();
-    bool quit = false;
+    // With --capture, every emulated frame is recorded.
+    std::unique_ptr<Capture> capture;
 
-    while(!quit)
+    if(captureFile)
     {
-        quit = platform.process_input(chip8.keypad);
+        capture = std::make_unique<Capture>(captureFile, scale);
+
+        if(!capture->is_open())
+        {
+            std::cerr << "Cannot write " << captureFile << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
 
-        auto now = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(now - lastCycle).count();
+    // With --shm, every emulated frame is also published to a shared
+    // memory segment, which other processes can attach to with
+    // SharedReader; the keys they hold there are pressed on the machine.
+    std::unique_ptr<SharedPublisher> shared;
 
-        if(dt > delay)
+    if(sharedName)
+    {
+#ifdef CHIP8_SHARED_MEMORY
+        shared = std::make_unique<SharedPublisher>();
+
+        if(!shared->open(sharedName))
         {
-            lastCycle = now;
-            chip8.cycle();
-            platform.update(chip8.video, pitch);
+            if(errno == EEXIST)
+                std::cerr << "Shared memory segment " << sharedName << " already exists: another emulator is"
+                          << " publishing to it, or one exited without removing it (see /dev/shm)\n";
+            else
+                std::cerr << "Cannot create shared memory segment " << sharedName << "\n";
+            std::exit(EXIT_FAILURE);
         }
+#else
+        std::cerr << "Shared memory is not available on this platform\n";
+        std::exit(EXIT_FAILURE);
+#endif
     }
 
+    // Telemetry is always collected, for the overlay; with --stats, it
+    // is also written to a file every second.
+    Telemetry telemetry {statsFile};
+
+    // Emulation runs on its own thread, so that a slow present (vsync,
+    // compositor stalls...) never holds it up. It hands the frames over
+    // to this thread, which draws them and polls input, through a triple
+    // buffer; keypad events go the other way through a ring buffer, and
+    // the fast-forward toggle and achieved speed as atomics.
+    struct Frame
+    {
+        std::array<uint32_t, VIDEO_WIDTH * VIDEO_HEIGHT> pixels;
+        unsigned width, height;
+    };
+
+    TripleBuffer<Frame> frames;
+
+    RingBuffer<KeypadEvent, 256> keyEvents;
+    std::atomic<bool> fastForward {headless && turboGiven}, quit {false};
+    std::atomic<float> speed {0};
+
+    std::thread emulation([&]
+    {
+        // The machine runs in frames of 1/60 s: each frame, the
+        // instructions due in that time (one every 'delay' milliseconds)
+        // are run, then the timers tick and the frame is published. The
+        // fractional part of the instruction count is carried over to
+        // the next frame.
+        using clock = std::chrono::steady_clock;
+        const auto framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / 60));
+        const float cyclesPerFrame = (1000.0f / 60) / std::max(delay, 1);
+
+        auto nextFrame = clock::now();
+        float cycleBudget = 0;
+        uint64_t frameCount = 0;
+
+        // Instruction count at which the frame being run ends. When the
+        // debugger stops the machine in the middle of a frame, the rest
+        // of it (the instructions left, and the timer tick) is run once
+        // the machine resumes, so that the timers don't fall behind.
+        uint64_t frameEnd = 0;
+        bool frameStopped = false;
+
+        // Whether 'video' shows the machine as it is now, so that the
+        // window doesn't convert the planes again when the last frame
+        // emulated was already rendered for the capture or shared memory.
+        bool rendered = false;
+
+        // Returns false if the debugger stopped the machine in the middle
+        // of the frame, in which case no more frames must be run.
+        auto emulate_frame = [&]
+        {
+            // Timing a frame takes two reads of the clock, which can cost
+            // more than the frame itself when fast-forwarding through a
+            // program waiting for its timers: then, only some are timed.
+            bool timed = frameCount % FAST_FORWARD_TIMING_INTERVAL == 0 || !fastForward.load(std::memory_order_relaxed);
+            auto frameStart = timed ? clock::now() : clock::time_point {};
+            uint64_t firstCycle = chip8.cycleCount;
+            rendered = false;
+
+            if(!frameStopped)
+            {
+                cycleBudget += cyclesPerFrame;
+                unsigned budget = static_cast<unsigned>(cycleBudget);
+                cycleBudget -= budget;
+                frameEnd = chip8.cycleCount + budget;
+            }
+
+            // Instructions the debugger single-stepped while the machine
+            // was stopped count toward the frame.
+            frameStopped = false;
+            unsigned cycles = frameEnd > chip8.cycleCount ? static_cast<unsigned>(frameEnd - chip8.cycleCount) : 0;
+
+            if(debugger.armed())
+            {
+                StopReason reason = debugger.run(cycles);
+
+                if(reason != StopReason::None)
+                {
+                    frameStopped = true;
+                    gdbStub->report(reason);
+                    return false;
+                }
+            }
+            else
+            {
+                chip8.run(cycles);
+            }
+
+            chip8.tick_timers();
+
+            // The display planes are only turned into pixels for what
+            // looks at every frame; the window only gets the last one.
+            if(capture || shared)
+            {
+                chip8.render();
+                rendered = true;
+            }
+
+            if(platform)
+                platform->push_sound(chip8.soundTimer);
+
+            if(capture)
+                capture->push(chip8.video, chip8.videoWidth, chip8.videoHeight);
+
+            ++frameCount;
+
+            if(shared)
+                shared->publish(chip8, frameCount);
+
+            telemetry.record_frame(chip8.cycleCount - firstCycle);
+
+            if(timed)
+                telemetry.record_frame_time(clock::now() - frameStart);
+
+            if(frameLimit && frameCount == frameLimit)
+            {
+                quit.store(true, std::memory_order_relaxed);
+                return false;
+            }
+
+            return true;
+        };
+
+        // Keypad events that happened during the previous frame are
+        // replayed at the same relative position in the frame to come,
+        // which is timed from 'lastFrameTicks'. Their timestamps are in
+        // SDL ticks; headless, there is no SDL and no keyboard, and the
+        // frames are timed on the steady clock instead.
+        auto frame_ticks = [&]
+        {
+            if(platform)
+                return Platform::ticks();
+
+            return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(clock::now().time_since_epoch()).count());
+        };
+
+        uint32_t lastFrameTicks = frame_ticks();
+
+        // The achieved speed, relative to 60 emulated frames per
+        // second, is reported once a second while fast-forwarding.
+        auto lastReport = clock::now();
+        unsigned framesSinceReport = 0;
+
+        uint16_t keyboardKeys = 0, sharedKeys = 0;
+
+        while(!quit.load(std::memory_order_relaxed) && !interrupted.load(std::memory_order_relaxed))
+        {
+            // A trace asked for with SIGUSR1 is written here, between
+            // two frames, rather than from the signal handler.
+            if(tracer && Tracer::flush_requested())
+                tracer->flush(traceFile);
+
+            auto now = clock::now();
+
+            // If we fell behind (the machine was suspended...), don't
+            // try to catch up.
+            nextFrame = (now - nextFrame > framePeriod) ? now + framePeriod : nextFrame + framePeriod;
+
+            uint32_t frameTicks = frame_ticks();
+            uint32_t frameLength = std::max(frameTicks - lastFrameTicks, 1u);
+
+            // Keys held in the shared memory segment are pressed along
+            // with the ones of the keyboard, from the start of the frame.
+            if(shared)
+            {
+                uint16_t keys = shared->keypad();
+
+                if(keys != sharedKeys)
+                {
+                    sharedKeys = keys;
+                    chip8.queue_key_event(chip8.cycleCount, keyboardKeys | sharedKeys);
+                }
+            }
+
+            KeypadEvent event;
+
+            while (keyEvents.pop(event))
+            {
+                float position = std::clamp(static_cast<float>(static_cast<int32_t>(event.timestamp - lastFrameTicks)) / frameLength, 0.0f, 1.0f);
+                keyboardKeys = event.keys;
+                chip8.queue_key_event(chip8.cycleCount + static_cast<uint64_t>(position * cyclesPerFrame), keyboardKeys | sharedKeys);
+            }
+
+            lastFrameTicks = frameTicks;
+
+            // While the debugger has the machine stopped, only serve it,
+            // waiting for its requests for the time of a frame.
+            if(gdbStub)
+            {
+                gdbStub->poll(16);
+
+                if(gdbStub->halted())
+                    continue;
+            }
+
+            // In fast-forward, several frames are emulated for each one
+            // published: 'turbo' of them, or as many as fit until the
+            // next frame is due if it is 0. Only the last one is shown,
+            // so that presenting doesn't limit the emulation speed.
+            bool fast = fastForward.load(std::memory_order_relaxed);
+
+            if(!fast)
+            {
+                if(emulate_frame())
+                    ++framesSinceReport;
+            }
+            else if(turbo > 0)
+            {
+                for (int i = 0; i < turbo && emulate_frame(); ++i)
+                {
+                    ++framesSinceReport;
+                }
+            }
+            else
+            {
+                while (emulate_frame())
+                {
+                    ++framesSinceReport;
+
+                    if(clock::now() >= nextFrame)
+                        break;
+                }
+            }
+
+            if(platform)
+            {
+                if(!rendered)
+                    chip8.render();
+
+                Frame& frame = frames.back();
+                std::memcpy(frame.pixels.data(), chip8.video, chip8.videoWidth * chip8.videoHeight * sizeof(uint32_t));
+                frame.width = chip8.videoWidth;
+                frame.height = chip8.videoHeight;
+                frames.publish();
+            }
+
+            float elapsed = std::chrono::duration<float>(now - lastReport).count();
+
+            if(elapsed >= 1.0f)
+            {
+                speed.store(fast ? framesSinceReport / (elapsed * 60) : 0, std::memory_order_relaxed);
+                lastReport = now;
+                framesSinceReport = 0;
+            }
+
+            std::this_thread::sleep_until(nextFrame);
+        }
+
+        quit.store(true, std::memory_order_relaxed);
+    });
+
+    if(headless)
+    {
+        emulation.join();
+
+        if(tracer)
+            tracer->flush(traceFile);
+
+        return 0;
+    }
+
+    std::vector<KeypadEvent> inputEvents;
+    float shownSpeed = 0;
+    uint64_t shownReport = 0;
+
+    while(!quit.load(std::memory_order_relaxed))
+    {
+        inputEvents.clear();
+        bool quitRequested = platform->process_input(inputEvents);
+
+        for (const auto& event : inputEvents)
+        {
+            keyEvents.push(event);
+        }
+
+        fastForward.store(platform->fast_forward(), std::memory_order_relaxed);
+
+        // The overlay's text only changes with each report.
+        if(platform->overlay_shown())
+        {
+            TelemetryStats stats = telemetry.stats();
+
+            if(stats.report != shownReport)
+            {
+                platform->set_overlay(telemetry_overlay(stats));
+                shownReport = stats.report;
+            }
+        }
+
+        if(frames.fetch())
+        {
+            const Frame& frame = frames.front();
+
+            auto presentStart = std::chrono::steady_clock::now();
+            platform->update(frame.pixels.data(), frame.width, frame.height);
+            telemetry.record_present(std::chrono::steady_clock::now() - presentStart);
+        }
+        else
+        {
+            // Nothing new to show: don't spin, but wake up early if a
+            // key is pressed.
+            platform->wait_input(1);
+        }
+
+        // Show the fast-forward speed in the title (0 when it is off)
+        float currentSpeed = platform->fast_forward() ? speed.load(std::memory_order_relaxed) : 0;
+
+        if(currentSpeed != shownSpeed)
+        {
+            if(currentSpeed > 0)
+            {
+                char text[64];
+                std::snprintf(text, sizeof(text), "%s - %.1fx", title, currentSpeed);
+                platform->set_title(text);
+            }
+            else
+            {
+                platform->set_title(title);
+            }
+
+            shownSpeed = currentSpeed;
+        }
+
+        if(quitRequested)
+            quit.store(true, std::memory_order_relaxed);
+    }
+
+    emulation.join();
+
+    if(tracer)
+        tracer->flush(traceFile);
+
     return 0;
 }
@@ -0,0 +1,85 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "SharedMemory.hpp"
+
+// Demo consumer of the shared memory segment of an emulator started with
+// --shm: draws its display in the terminal, and holds the given keys
+// (a mask, in hex: bit i for key i) until interrupted.
+
+static std::atomic<bool> interrupted {false};
+
+static void on_interrupt(int)
+{
+    interrupted.store(true);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <Name> [<Keys>]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    SharedReader reader;
+
+    if(!reader.attach(argv[1]))
+    {
+        std::cerr << "No emulator publishing to " << argv[1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint16_t keys = argc == 3 ? static_cast<uint16_t>(std::stoul(argv[2], nullptr, 16)) : 0;
+    reader.set_keypad(keys);
+
+    std::signal(SIGINT, on_interrupt);
+    std::signal(SIGTERM, on_interrupt);
+
+    SharedSnapshot snapshot;
+    uint64_t lastFrame = UINT64_MAX;
+    std::string screen;
+
+    std::fputs("\x1b[2J", stdout);
+
+    while (!interrupted.load())
+    {
+        // Reads only fail if the emulator publishes faster than we can
+        // copy, in which case we simply try again next time.
+        if(reader.read(snapshot) && snapshot.frame != lastFrame)
+        {
+            lastFrame = snapshot.frame;
+
+            // Home the cursor and redraw, a line of text per row of pixels.
+            screen = "\x1b[H";
+
+            for (unsigned y = 0; y < snapshot.height; ++y)
+            {
+                for (unsigned x = 0; x < snapshot.width; ++x)
+                {
+                    screen += snapshot.video[y * snapshot.width + x] ? '#' : ' ';
+                }
+
+                screen += '\n';
+            }
+
+            std::fputs(screen.c_str(), stdout);
+            std::printf("frame %llu  DT %3u  ST %3u  keys %04X\n",
+                        static_cast<unsigned long long>(snapshot.frame),
+                        snapshot.delayTimer, snapshot.soundTimer, keys);
+            std::fflush(stdout);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }
+
+    // Let go of the keys on the way out.
+    reader.set_keypad(0);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "Disassembler.hpp"
+#include "Tracer.hpp"
+
+// Offline decoder for the traces written by Tracer: prints each
+// recorded instruction with its mnemonic and what it changed.
+int main(int argc, char** argv)
+{
+    if(argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <Trace>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::FILE* file = std::fopen(argv[1], "rb");
+
+    if(!file)
+    {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    TraceHeader header {};
+
+    if(std::fread(&header, sizeof(header), 1, file) != 1
+        || std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION
+        || header.recordSize != sizeof(TraceRecord))
+    {
+        std::cerr << argv[1] << " is not a CHIP-8 trace (or was written by another version)\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    TraceRecord record {};
+
+    for (uint64_t i = 0; i < header.count && std::fread(&record, sizeof(record), 1, file) == 1; ++i)
+    {
+        std::printf("%12llu  0x%03X  %04X  %-20s",
+                    static_cast<unsigned long long>(record.cycle),
+                    record.pc, record.opcode, disassemble(record.opcode).c_str());
+
+        for (unsigned r = 0; r < REGISTER_COUNT; ++r)
+        {
+            if(record.changed & (1u << r))
+                std::printf(" V%X=%02X", r, record.registers[r]);
+        }
+
+        if(record.flags & TRACE_INDEX_CHANGED)
+            std::printf(" I=0x%03X", record.index);
+
+        // Memory writes only store where they happened; the bytes
+        // written are found again from the registers, exactly as the
+        // instructions computed them.
+        if(record.writeLength)
+        {
+            std::printf(" [0x%03X]=", record.writeAddress);
+
+            uint8_t Vx = (record.opcode & 0x0F00u) >> 8u;
+
+            if((record.opcode & 0xF0FFu) == 0xF033u)
+            {
+                uint8_t value = record.registers[Vx];
+                std::printf("%02X %02X %02X", value / 100, (value / 10) % 10, value % 10);
+            }
+            else if((record.opcode & 0xF00Fu) == 0x5002u)
+            {
+                // SAVE Vx - Vy, in reverse order if x > y
+                uint8_t Vy = (record.opcode & 0x00F0u) >> 4u;
+                int step = (Vx <= Vy) ? 1 : -1;
+
+                for (int r = 0; r < record.writeLength; ++r)
+                {
+                    std::printf("%s%02X", r ? " " : "", record.registers[Vx + r * step]);
+                }
+            }
+            else
+            {
+                for (int r = 0; r < record.writeLength; ++r)
+                {
+                    std::printf("%s%02X", r ? " " : "", record.registers[r]);
+                }
+            }
+        }
+
+        std::printf("\n");
+    }
+
+    std::fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+#include "Quirks.hpp"
+#include "Tracer.hpp"
+
+// Conformance test: runs one of the test ROMs listed in the goldens file
+// for a number of 60 Hz frames, with one of the execution engines, and
+// compares a hash of the final machine state (display planes and mode,
+// registers, stack, timers, keypad and memory) with the one recorded in
+// the file. Every engine is checked against the same golden, so that a
+// faster engine is known to leave the machine exactly as the plain
+// interpreter does.
+//
+// Each line of the goldens file is
+//  <Name> <ROM> <Profile> <Frames> <Hash> [<Frame>[+<Cycle>]:<Keys>...]
+// where the ROM is relative to the file, and each <Frame>:<Keys> sets the
+// keypad (a mask in hexadecimal) at the start of a frame, or, with
+// +<Cycle>, that many instructions into it.
+
+// Instructions per frame, as with a delay of 1 ms.
+const unsigned CYCLES_PER_FRAME = 16;
+
+struct Golden
+{
+    std::string name, rom, profile;
+    uint64_t frames = 0, hash = 0;
+    struct Keys
+    {
+        uint64_t frame, cycle;
+        uint16_t keys;
+    };
+
+    std::vector<Keys> keys;
+};
+
+static bool find_golden(const std::string& filename, const std::string& name, Golden& golden)
+{
+    std::ifstream file {filename};
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields {line};
+
+        if(!(fields >> golden.name) || golden.name != name)
+            continue;
+
+        if(!(fields >> golden.rom >> golden.profile >> golden.frames >> std::hex >> golden.hash))
+            return false;
+
+        std::string key;
+
+        while (fields >> key)
+        {
+            size_t colon = key.find(':');
+            size_t plus = key.find('+');
+
+            if(colon == std::string::npos || (plus != std::string::npos && plus > colon))
+                return false;
+
+            Golden::Keys event;
+            event.frame = std::stoull(key.substr(0, std::min(plus, colon)));
+            event.cycle = (plus != std::string::npos) ? std::stoull(key.substr(plus + 1, colon - plus - 1)) : 0;
+            event.keys = static_cast<uint16_t>(std::stoul(key.substr(colon + 1), nullptr, 16));
+            golden.keys.push_back(event);
+        }
+
+        // ROMs are found next to the goldens file
+        size_t slash = filename.find_last_of('/');
+
+        if(slash != std::string::npos)
+            golden.rom = filename.substr(0, slash + 1) + golden.rom;
+
+        return true;
+    }
+
+    return false;
+}
+
+// FNV-1a over the machine state, fed byte by byte in a fixed order so
+// that the goldens don't depend on the host's endianness.
+class StateHash
+{
+    public:
+
+        void add(uint64_t value, unsigned bytes)
+        {
+            for (unsigned i = 0; i < bytes; ++i)
+            {
+                hash ^= (value >> (8 * i)) & 0xFFu;
+                hash *= 0x100000001B3u;
+            }
+        }
+
+        uint64_t value() const { return hash; }
+
+    private:
+
+        uint64_t hash = 0xCBF29CE484222325u;
+};
+
+static uint64_t hash_state(Chip8& chip8)
+{
+    StateHash hash;
+
+    // The display as it is shown, in the resolution in use, and the
+    // planes it comes from, whole
+    chip8.render();
+
+    hash.add(chip8.videoWidth, 2);
+    hash.add(chip8.videoHeight, 2);
+
+    for (unsigned i = 0; i < chip8.videoWidth * chip8.videoHeight; ++i)
+        hash.add(chip8.video[i], 4);
+
+    for (const auto& plane : chip8.planes)
+        for (const auto& row : plane)
+            for (uint64_t word : row)
+                hash.add(word, 8);
+
+    hash.add(chip8.planeMask, 1);
+
+    for (uint8_t reg : chip8.registers)
+        hash.add(reg, 1);
+
+    for (uint8_t flag : chip8.rplFlags)
+        hash.add(flag, 1);
+
+    for (uint16_t level : chip8.stack)
+        hash.add(level, 2);
+
+    hash.add(chip8.index, 2);
+    hash.add(chip8.pc, 2);
+    hash.add(chip8.opcode, 2);
+    hash.add(chip8.keypad, 2);
+    hash.add(chip8.sp, 1);
+    hash.add(chip8.delayTimer, 1);
+    hash.add(chip8.soundTimer, 1);
+    hash.add(chip8.cycleCount, 8);
+
+    for (uint8_t byte : chip8.memory)
+        hash.add(byte, 1);
+
+    return hash.value();
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <Goldens> <Name> <cycle|run|trace|debugger|stops>\n";
+        return EXIT_FAILURE;
+    }
+
+    Golden golden;
+
+    if(!find_golden(argv[1], argv[2], golden))
+    {
+        std::cerr << "No valid golden for " << argv[2] << " in " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    QuirkProfile profile;
+
+    if(!parse_quirk_profile(golden.profile, profile))
+    {
+        std::cerr << "Unknown quirk profile " << golden.profile << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string engine = argv[3];
+
+    if(engine != "cycle" && engine != "run" && engine != "trace" && engine != "debugger" && engine != "stops")
+    {
+        std::cerr << "Unknown engine " << engine << "\n";
+        return EXIT_FAILURE;
+    }
+
+    auto chip8 = std::make_unique<Chip8>();
+    chip8->randGen.seed(0);
+    chip8->set_quirks(profile);
+    chip8->load_ROM(golden.rom.c_str());
+
+    // The engines:
+    //  - cycle: Chip8::cycle(), one instruction at a time;
+    //  - run: Chip8::run(), which skips wait loops;
+    //  - trace: Chip8::run() with a tracer attached;
+    //  - debugger: Debugger::run(), armed with a breakpoint that is
+    //  never reached;
+    //  - stops: Debugger::run(), with a breakpoint at every address and
+    //  every byte of memory and every register watched, so that it stops
+    //  at (nearly) every instruction, and is resumed each time, as the
+    //  emulator does, until the frame is done. At some breakpoints, an
+    //  instruction is run without the debugger instead (as when the
+    //  client clears the breakpoints and continues), after which the
+    //  debugger must stop at the next one.
+    std::unique_ptr<Tracer> tracer;
+    Debugger debugger {*chip8};
+
+    if(engine == "trace")
+    {
+        tracer = std::make_unique<Tracer>(1u << 12);
+        chip8->tracer = tracer.get();
+    }
+    else if(engine == "debugger")
+    {
+        debugger.set_breakpoint(0x000);
+    }
+    else if(engine == "stops")
+    {
+        for (unsigned address = 0; address < MEMORY_SIZE; ++address)
+            debugger.set_breakpoint(static_cast<uint16_t>(address));
+
+        debugger.set_watchpoint(0, static_cast<uint16_t>(MEMORY_SIZE - 1));
+        debugger.set_watchpoint(static_cast<uint16_t>(MEMORY_SIZE - 1), 1);
+
+        for (unsigned reg = 0; reg <= WATCH_INDEX; ++reg)
+            debugger.watch_register(reg, true);
+    }
+
+    // For the stops engine: the number of stops of some kinds, to check
+    // they happen, the cycle of the last breakpoint stop, whether the
+    // instruction it stopped at writes to memory, and whether the
+    // machine ran without the debugger since.
+    uint64_t breakpointStops = 0, registerStops = 0;
+    uint64_t lastBreakpoint = UINT64_MAX;
+    bool writing = false, moved = false;
+
+    auto key = golden.keys.begin();
+
+    for (uint64_t frame = 0; frame < golden.frames; ++frame)
+    {
+        for (; key != golden.keys.end() && key->frame <= frame; ++key)
+        {
+            chip8->queue_key_event(chip8->cycleCount + key->cycle, key->keys);
+        }
+
+        if(engine == "cycle")
+        {
+            for (unsigned i = 0; i < CYCLES_PER_FRAME; ++i)
+            {
+                chip8->cycle();
+            }
+        }
+        else if(engine == "debugger")
+        {
+            if(debugger.run(CYCLES_PER_FRAME) != StopReason::None)
+            {
+                std::cerr << "The debugger stopped at 0x" << std::hex << chip8->pc << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else if(engine == "stops")
+        {
+            uint64_t frameEnd = chip8->cycleCount + CYCLES_PER_FRAME;
+
+            while (chip8->cycleCount < frameEnd)
+            {
+                StopReason reason = debugger.run(frameEnd - chip8->cycleCount);
+
+                // Resuming from a breakpoint must run the instruction it
+                // stopped at, not stop there again, and an instruction
+                // writing to memory must stop at the watchpoint.
+                if(reason == StopReason::Breakpoint && chip8->cycleCount == lastBreakpoint)
+                {
+                    std::cerr << "The debugger didn't resume from 0x" << std::hex << chip8->pc << "\n";
+                    return EXIT_FAILURE;
+                }
+
+                if(writing && reason != StopReason::Watchpoint)
+                {
+                    std::cerr << "The debugger missed a memory write before 0x" << std::hex << chip8->pc << "\n";
+                    return EXIT_FAILURE;
+                }
+
+                if(moved && (reason != StopReason::Breakpoint || chip8->cycleCount != lastBreakpoint + 1))
+                {
+                    std::cerr << "The debugger missed the breakpoint at 0x" << std::hex << chip8->pc << "\n";
+                    return EXIT_FAILURE;
+                }
+
+                writing = moved = false;
+
+                if(reason == StopReason::Breakpoint)
+                {
+                    ++breakpointStops;
+                    lastBreakpoint = chip8->cycleCount;
+
+                    if(breakpointStops % 5 == 0)
+                    {
+                        chip8->cycle();
+                        moved = true;
+                        continue;
+                    }
+
+                    uint16_t opcode = (chip8->memory[chip8->pc % MEMORY_SIZE] << 8u) | chip8->memory[(chip8->pc + 1) % MEMORY_SIZE];
+                    writing = memory_write_length(opcode) > 0;
+                }
+                else if(reason == StopReason::RegisterWatch)
+                {
+                    ++registerStops;
+                }
+            }
+        }
+        else
+        {
+            chip8->run(CYCLES_PER_FRAME);
+        }
+
+        chip8->tick_timers();
+    }
+
+    // Every instruction is a breakpoint, and all the test ROMs set
+    // registers; only some write to memory.
+    if(engine == "stops" && (breakpointStops == 0 || registerStops == 0))
+    {
+        std::cerr << "The debugger didn't stop at breakpoints and register writes\n";
+        return EXIT_FAILURE;
+    }
+
+    uint64_t hash = hash_state(*chip8);
+
+    if(hash != golden.hash)
+    {
+        std::fprintf(stderr, "%s (%s): state hash %016llx, expected %016llx\n", golden.name.c_str(), engine.c_str(),
+                     static_cast<unsigned long long>(hash), static_cast<unsigned long long>(golden.hash));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+; Source of delayloop.ch8: loops waiting for the delay timer with
+; 'LD Vx, DT' and 'SE/SNE Vx, kk', first entered through the jump closing
+; them with a value that leaves them at once, then from the top.
+; Each value of V0 on leaving is drawn in hexadecimal, in a grid, by
+; 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+
+main:
+  LD V1, 0
+  LD V2, 0
+; SE V0, 5 reached through its jump with V0 already 5: leaves at once
+  LD V5, 5
+  LD DT, V5
+  LD V0, DT
+  JP se_jump
+se_loop:
+  LD V0, DT
+  SE V0, 5
+se_jump:
+  JP se_loop
+  LD V0, DT
+  CALL show
+; SNE V0, 3 reached through its jump with V0 at 10: leaves at once
+  LD V5, 10
+  LD DT, V5
+  LD V0, DT
+  JP sne_jump
+sne_loop:
+  LD V0, DT
+  SNE V0, 3
+sne_jump:
+  JP sne_loop
+  LD V0, DT
+  CALL show
+; The same loops entered from the top, waiting for the timer
+  LD V5, 20
+  LD DT, V5
+se_wait:
+  LD V0, DT
+  SE V0, 5
+  JP se_wait
+  CALL show
+  LD V5, 30
+  LD DT, V5
+sne_wait:
+  LD V0, DT
+  SNE V0, 30
+  JP sne_wait
+  CALL show
+end:
+  JP end
@@ -0,0 +1,118 @@
+; Source of flags.ch8: VF after ADD, SUB, SUBN, SHR and SHL (with x =
+; y), with VF as an operand, and after DRW collisions.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+  LD V0, 0
+  LD F, V0
+  DRW V1, V2, 5
+  LD VC, VF
+  DRW V1, V2, 5
+  LD VD, VF
+  LD V0, 0xF0
+  LD V5, 0x20
+  ADD V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x10
+  LD V5, 0x20
+  ADD V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x30
+  LD V5, 0x10
+  SUB V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x10
+  LD V5, 0x30
+  SUB V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x10
+  LD V5, 0x10
+  SUB V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x10
+  LD V5, 0x30
+  SUBN V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x30
+  LD V5, 0x10
+  SUBN V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x81
+  SHR V0
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x02
+  SHR V0
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x81
+  SHL V0
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x40
+  SHL V0
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD VF, 0xF0
+  ADD VF, VF
+  LD V0, VF
+  CALL show
+  LD V0, VC
+  CALL show
+  LD V0, VD
+  CALL show
+end:
+  JP end
@@ -0,0 +1,86 @@
+; Source of hires.ch8: the SUPER-CHIP high resolution, 16x16 sprites
+; clipped or wrapped at the corner, the big font, scrolling, the RPL
+; flags and the 4-byte skip over LD index, nnnn.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  HIGH
+  LD V1, 0
+  LD V2, 0
+  ; 16x16 sprite across the bottom right corner: clipped or wrapped
+  LD I, box
+  LD V6, 120
+  LD V7, 58
+  DRW V6, V7, 0
+  LD V0, VF
+  CALL show
+  ; big font digit
+  LD V0, 7
+  LD HF, V0
+  LD V6, 100
+  LD V7, 20
+  DRW V6, V7, 10
+  ; a 16x16 sprite, scrolled down, right twice and left once
+  LD I, box
+  LD V6, 60
+  LD V7, 30
+  DRW V6, V7, 0
+  SCD 3
+  SCR
+  SCR
+  SCL
+  ; drawing it again where it went leaves it half erased
+  LD V7, 33
+  DRW V6, V7, 0
+  LD V0, VF
+  CALL show
+  ; RPL flags
+  LD V0, 0x12
+  LD V1, 0x34
+  LD V2, 0x56
+  LD R, V2
+  LD V0, 0
+  LD V1, 0
+  LD V2, 0
+  LD V2, R
+  LD V8, V1
+  LD V9, V2
+  LD V1, 26
+  LD V2, 0
+  CALL show
+  LD V0, V8
+  CALL show
+  LD V0, V9
+  CALL show
+  ; SE skipping the 4-byte LD index, nnnn
+  LD V0, 5
+  SE V0, 5
+  LONG 0x0000
+  LD V0, 0xAB
+  CALL show
+  EXIT
+box:
+  DB 0xFF 0xFF 0x80 0x01 0x80 0x01 0x80 0x01 0xBF 0xFD 0xA0 0x05 0xA0 0x05 0xA0 0x05
+  DB 0xA0 0x05 0xA0 0x05 0xA0 0x05 0xBF 0xFD 0x80 0x01 0x80 0x01 0x80 0x01 0xFF 0xFF
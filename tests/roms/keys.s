@@ -0,0 +1,37 @@
+; Source of keys.ch8: LD Vx, K and a SKNP wait loop for the key to be
+; released.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+loop:
+  LD V0, K
+  LD VC, V0
+  CALL show
+release:
+  SKNP VC
+  JP release
+  JP loop
@@ -0,0 +1,48 @@
+; Source of midframe.ch8: a SKP wait loop for key 5, then a count of the
+; instructions run until the next timer tick, which tells how far into
+; its frame the key press was seen.
+; Each count is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+
+main:
+  LD V1, 0
+  LD V2, 0
+  LD VC, 5
+wait:
+  SKP VC
+  JP wait
+  LD V6, 1
+  LD DT, V6
+  LD V0, 0
+count:
+  ADD V0, 1
+  LD V6, DT
+  SE V6, 0
+  JP count
+  CALL show
+release:
+  SKNP VC
+  JP release
+  JP wait
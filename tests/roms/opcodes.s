@@ -0,0 +1,138 @@
+; Source of opcodes.ch8: every instruction but the flag-setting and
+; quirk-dependent ones.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+  LD V0, 8
+  LD F, V0
+  DRW V1, V2, 5
+  CLS
+  LD V0, 0x42
+  CALL show
+  LD V0, 0xF0
+  ADD V0, 0x15
+  CALL show
+  LD V5, 0x37
+  LD V0, V5
+  CALL show
+  LD V0, 0x0C
+  LD V5, 0x30
+  OR V0, V5
+  CALL show
+  LD V0, 0x3C
+  LD V5, 0x0F
+  AND V0, V5
+  CALL show
+  LD V0, 0xFF
+  XOR V0, V5
+  CALL show
+  LD V6, 5
+  LD V0, 0xAA
+  SE V6, 5
+  LD V0, 0
+  CALL show
+  LD V0, 0xBB
+  SNE V6, 5
+  LD V0, 0xBC
+  SNE V6, 6
+  LD V0, 0
+  CALL show
+  LD V7, 5
+  LD V0, 0xC0
+  SE V6, V7
+  LD V0, 0
+  CALL show
+  LD V0, 0xD0
+  SNE V6, V7
+  LD V0, 0xD1
+  SNE V6, V5
+  LD V0, 0
+  CALL show
+  CALL outer
+  CALL show
+  LD I, buf
+  LD V0, 0x5A
+  LD [I], V0
+  LD V0, 0
+  LD I, buf
+  LD V0, [I]
+  CALL show
+  LD V8, V1
+  LD V9, V2
+  LD V0, 254
+  LD I, buf
+  LD B, V0
+  LD I, buf+1
+  LD V1, [I]
+  LD VA, V0
+  SHL VA
+  SHL VA
+  SHL VA
+  SHL VA
+  ADD VA, V1
+  LD V0, VA
+  LD V1, V8
+  LD V2, V9
+  CALL show
+  LD I, buf
+  LD V0, 3
+  ADD I, V0
+  LD V0, 0x99
+  LD [I], V0
+  LD I, buf+3
+  LD V0, [I]
+  CALL show
+  LD V0, 0x20
+  LD DT, V0
+  LD V0, DT
+  CALL show
+  LD V0, 3
+  LD ST, V0
+  LD V0, 0xE1
+  LD VA, 3
+  SKP VA
+  LD V0, 0xE2
+  SKNP VA
+  LD V0, 0
+  CALL show
+  LD V0, 0x99
+  RND V0, 0
+  CALL show
+  LD VF, 7
+  ADD VF, 0xFF
+  LD V0, VF
+  CALL show
+end:
+  JP end
+outer:
+  CALL inner
+  RET
+inner:
+  LD V0, 0x77
+  RET
+buf:
+  DB 0 0 0 0
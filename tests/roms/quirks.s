@@ -0,0 +1,105 @@
+; Source of quirks.ch8: the instructions whose behavior changes with the
+; quirk profile.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+  LD V0, 0x04
+  LD V5, 0x81
+  SHR V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 0x04
+  LD V5, 0x81
+  SHL V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V8, V1
+  LD V9, V2
+  LD I, buf
+  LD V0, 0xAB
+  LD [I], V0
+  LD V0, 0xCD
+  LD [I], V0
+  LD I, buf
+  LD V1, [I]
+  LD VA, V1
+  LD V1, V8
+  LD V2, V9
+  CALL show
+  LD V0, VA
+  CALL show
+  LD VF, 5
+  LD V0, 0x0F
+  LD V5, 0xF0
+  OR V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD VF, 5
+  LD V0, 0x3C
+  LD V5, 0xF0
+  AND V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD VF, 5
+  LD V0, 0x3C
+  LD V5, 0xF0
+  XOR V0, V5
+  LD VB, VF
+  CALL show
+  LD V0, VB
+  CALL show
+  LD V0, 2
+  LD V3, 6
+  JP V0, 0x300
+back:
+  CALL show
+  LD V6, 60
+  LD V7, 29
+  LD V0, 0xE
+  LD F, V0
+  DRW V6, V7, 5
+  LD V6, 108
+  LD V7, 50
+  DRW V6, V7, 5
+end:
+  JP end
+buf:
+  DB 0 0
+ORG 0x302
+  LD V0, 0xA2
+  JP back
+ORG 0x306
+  LD V0, 0xA6
+  JP back
@@ -0,0 +1,49 @@
+; Source of timers.ch8: counting delay timer expirations, waiting for
+; them in a LD Vx, DT loop; then the sound timer, and a SKP wait loop.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+  LD VC, 0
+loop:
+  LD V0, VC
+  CALL show
+  LD V5, 6
+  LD DT, V5
+wait:
+  LD V5, DT
+  SE V5, 0
+  JP wait
+  ADD VC, 1
+  SE VC, 12
+  JP loop
+  LD V5, 30
+  LD ST, V5
+  LD VA, 5
+idle:
+  SKP VA
+  JP idle
+  JP main
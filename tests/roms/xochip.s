@@ -0,0 +1,74 @@
+; Source of xochip.ch8: the XO-CHIP planes, drawing, scrolling only
+; some of them, a sprite beyond 4K, SAVE/LOAD of register ranges and
+; the 4-byte skip over LD index, nnnn.
+; Each result is drawn in hexadecimal, in a grid, by 'show'.
+
+  JP main
+; show: draws V0 in hex at (V1, V2), then moves to the next cell
+show:
+  LD V3, V0
+  SHR V3
+  SHR V3
+  SHR V3
+  SHR V3
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 5
+  LD V3, V0
+  LD V4, 0x0F
+  AND V3, V4
+  LD F, V3
+  DRW V1, V2, 5
+  ADD V1, 7
+  SE V1, 60
+  RET
+  LD V1, 0
+  ADD V2, 6
+  RET
+main:
+  LD V1, 0
+  LD V2, 0
+  ; a sprite in 64K memory, drawn on both planes
+  PLANE 3
+  LONG far
+  LD V6, 20
+  LD V7, 12
+  DRW V6, V7, 8
+  ; only the second plane scrolls up, only the first one right
+  PLANE 2
+  SCU 2
+  PLANE 1
+  SCR
+  ; save and load ranges of registers, the second in reverse
+  LD V2, 0x11
+  LD V3, 0x22
+  LD V4, 0x33
+  LD V5, 0x44
+  LONG far2
+  SAVE V2 - V5
+  LOAD V5 - V2
+  LD V0, V2
+  LD V2, 0
+  LD V1, 0
+  CALL show
+  ; SE skipping the 4-byte LD index, nnnn
+  LD V0, 1
+  SE V0, 1
+  LONG far
+  LD V0, 0xCD
+  PLANE 3
+  LD V2, 24
+  LD V1, 36
+  CALL show
+  ; sprite wrapping around the bottom right corner
+  LD V6, 60
+  LD V7, 28
+  LONG far
+  DRW V6, V7, 8
+  EXIT
+ORG 0x1200
+far:
+  DB 0x3C 0x42 0x81 0xA5 0x81 0x99 0x42 0x3C
+  DB 0xFF 0x81 0x81 0x81 0x81 0x81 0x81 0xFF
+far2:
+  DB 0 0 0 0